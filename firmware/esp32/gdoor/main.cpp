@@ -19,11 +19,44 @@
 #include "src/mqtt_helper.h"
 #include "src/wifi_helper.h"
 #include "src/printer_helper.h"
+#include "src/gdoor_latency.h"
+#include "src/gdoor_metrics.h"
+#include "src/gdoor_busstats.h"
+#include "src/gdoor_profiler.h"
+#include "src/gdoor_isrstats.h"
+#include "src/gdoor_dedup.h"
+#include "src/gdoor_devices.h"
+#include "src/gdoor_command.h"
+#include "src/gdoor_correlation.h"
+#include "src/gdoor_rules.h"
+#include "src/gdoor_filter.h"
+#include "src/gdoor_sinks.h"
+#include "src/gdoor_udp.h"
+#include "src/gdoor_live.h"
+#include "src/gdoor_history.h"
+#include "src/gdoor_capture.h"
+#include "src/gdoor_serial.h"
+#include "src/gdoor_threshold.h"
 
 GDOOR_DATA_PROTOCOL gdoor_data_idle(NULL, true);
 
 boolean debug = false; // Global variable to indicate if we are in debug mode (true)
+boolean event_mode = false; // Global variable to indicate that bus messages are published as events, without BUS_IDLE reset
 const char* mqtt_topic_bus_rx = NULL;
+const char* mqtt_topic_diagnostics = NULL;
+
+/**
+ * Function which outputs diagnostic data
+ * via the serial port and the MQTT diagnostics topic.
+ * @param print_diagnostics Function which prints the json content, e.g. GDOOR_METRICS::printTo
+ * @param serial false: only send via MQTT
+*/
+void output_diagnostics(size_t (*print_diagnostics)(Print& p), bool serial=true) {
+    MQTT_HELPER::printer.print("{");
+    print_diagnostics(MQTT_HELPER::printer);
+    MQTT_HELPER::printer.println("}");
+    MQTT_HELPER::printer.publish(mqtt_topic_diagnostics, serial);
+}
 
 /**
  * Function which parses user provided serial input
@@ -38,88 +71,288 @@ boolean parse(String  &input) {
     } else if(input == "*normal") {
         debug = false;
         return true;
+    } else if(input == "*latency") {
+        output_diagnostics(GDOOR_LATENCY::printTo);
+        return true;
+    } else if(input == "*latency_reset") {
+        GDOOR_LATENCY::reset();
+        return true;
+    } else if(input == "*metrics") {
+        output_diagnostics(GDOOR_METRICS::printTo);
+        return true;
+    } else if(input == "*busstats") {
+        output_diagnostics(GDOOR_BUSSTATS::printTo);
+        return true;
+    } else if(input == "*profile") {
+        output_diagnostics(GDOOR_PROFILER::printTo);
+        return true;
+    } else if(input == "*profile_reset") {
+        GDOOR_PROFILER::reset();
+        return true;
+    } else if(input == "*devices") {
+        // One message per device, e.g. 32 devices do not fit into one MQTT message
+        if(GDOOR_DEVICES::size() == 0) {
+            MQTT_HELPER::printer.print("{");
+            GDOOR_UTILS::print_json_value<uint8_t>(MQTT_HELPER::printer, "devices", 0);
+            MQTT_HELPER::printer.println("}");
+            MQTT_HELPER::printer.publish(mqtt_topic_diagnostics);
+        }
+        for(uint8_t i=0; i<GDOOR_DEVICES::size(); i++) {
+            MQTT_HELPER::printer.print("{");
+            GDOOR_DEVICES::printTo(MQTT_HELPER::printer, i);
+            MQTT_HELPER::printer.println("}");
+            MQTT_HELPER::printer.publish(mqtt_topic_diagnostics);
+        }
+        return true;
+    } else if(input == "*isr") {
+        output_diagnostics(GDOOR_ISRSTATS::printTo);
+        return true;
+    } else if(input == "*isr_reset") {
+        GDOOR_ISRSTATS::reset();
+        return true;
+    } else if(input == "*acks") {
+        output_diagnostics(GDOOR_CORRELATION::printStatsTo);
+        return true;
+    } else if(input == "*acks_reset") {
+        GDOOR_CORRELATION::reset();
+        return true;
+    } else if(input == "*filter") {
+        MQTT_HELPER::printer.print("{");
+        GDOOR_UTILS::print_json_string(MQTT_HELPER::printer, "filter", GDOOR_FILTER::get());
+        MQTT_HELPER::printer.println("}");
+        MQTT_HELPER::printer.publish(mqtt_topic_diagnostics);
+        return true;
+    } else if(input.startsWith("*filter ")) {
+        if(GDOOR_FILTER::setup(input.substring(8).c_str())) {
+            WIFI_HELPER::save_publish_filter(GDOOR_FILTER::get());
+        } else {
+            JSONDEBUG("Invalid publish filter");
+        }
+        return true;
+    } else if(input == "*history" || input.startsWith("*history ")) {
+        // One message per frame, e.g. *history action=DOOR_OPEN last=3600
+        history_query query;
+        if(!GDOOR_HISTORY::parse_query(input.substring(8), query)) {
+            JSONDEBUG("Invalid history query");
+            return true;
+        }
+        query.limit = min(query.limit, (uint16_t)HISTORY_MQTT_LIMIT);
+        GDOOR_HISTORY::query(query, [](const history_entry &entry) {
+            MQTT_HELPER::printer.print("{");
+            GDOOR_HISTORY::printTo(MQTT_HELPER::printer, entry);
+            MQTT_HELPER::printer.println("}");
+            MQTT_HELPER::printer.publish(mqtt_topic_diagnostics);
+        });
+        return true;
+    } else if(input.startsWith("*capture ")) { // tcp, serial or off
+        if(!GDOOR_CAPTURE::set_mode(input.substring(9))) {
+            JSONDEBUG("Invalid capture mode");
+        }
+        return true;
+    } else if(input.startsWith("*serial ")) { // json or binary, until restart
+        if(!GDOOR_SERIAL::set_mode(input.substring(8))) {
+            JSONDEBUG("Invalid serial mode");
+        }
+        return true;
+    } else if(input == "*threshold") {
+        output_diagnostics(GDOOR_THRESHOLD::printTo);
+        return true;
+    } else if(input == "*calibrate") {
+        if(!GDOOR_THRESHOLD::calibrate()) {
+            JSONDEBUG("RX threshold is not set to auto");
+        }
+        return true;
+    } else if(input == "*rules") {
+        output_diagnostics(GDOOR_RULES::printTo);
+        return true;
+    } else if(input.startsWith("*rule ")) {
+        if(!GDOOR_RULES::add(input.substring(6))) {
+            JSONDEBUG("Invalid rule");
+        }
+        return true;
+    } else if(input.startsWith("*rule_delete ")) {
+        if(!GDOOR_RULES::remove(input.substring(13))) {
+            JSONDEBUG("Invalid rule index");
+        }
+        return true;
+    } else if(input == "*macros") {
+        output_diagnostics(GDOOR_COMMAND::printTo);
+        return true;
+    } else if(input.startsWith("*macro ")) {
+        if(!GDOOR_COMMAND::define_macro(input.substring(7))) {
+            JSONDEBUG("Invalid command macro");
+        }
+        return true;
+    } else if(input.startsWith("*macro_delete ")) {
+        GDOOR_COMMAND::delete_macro(input.substring(14));
+        return true;
     }
     return false;
 }
 
 /**
- * Function which outputs bus data via the serial port and MQTT.
+ * Function which outputs bus data via all outputs (MQTT, serial port, ...), see GDOOR_SINKS.
  * Depending in debug mode, it may output more data.
  * 
- * In normal mode, it also checks the valid flag and only
- * outputs valid bus messages.
+ * In normal mode, it also checks the valid flag and the
+ * publish filter and only outputs accepted bus messages.
  * @param busmessage The bus message to be send out to the user.
 */
 void output(GDOOR_DATA_PROTOCOL &busmessage, const char* topic, bool force=false) {
-    if(force || debug || (busmessage.raw != NULL && busmessage.raw->valid)) {
-        MQTT_HELPER::printer.print("{");
-        MQTT_HELPER::printer.print(busmessage);
-        MQTT_HELPER::printer.println("}");
-        MQTT_HELPER::printer.publish((const char*)topic);
+    if(force || debug || GDOOR_FILTER::accept(busmessage.raw)) {
+        GDOOR_SINKS::publish_message(busmessage, topic, force);
     }
 }
 
 void setup() {
-    Serial.begin(115200);
+    Serial.begin(SERIAL_BOOT_BAUD);
     Serial.setTimeout(1);
     JSONDEBUG("GDoor Setup start");
     
+    GDOOR_SINKS::add(&GDOOR_UDP::sink); // First, as it has the lowest latency
+    GDOOR_SINKS::add(&GDOOR_SERIAL::sink);
+    GDOOR_SINKS::add(&MQTT_HELPER::sink);
+    GDOOR_SINKS::add(&GDOOR_SINKS::serial);
+    GDOOR_SINKS::add(&GDOOR_LIVE::sink);
+
     WIFI_HELPER::setup();
+    GDOOR_SERIAL::setup(WIFI_HELPER::serial_baud(), WIFI_HELPER::serial_binary());
+    GDOOR_LIVE::setup();
+    GDOOR_HISTORY::setup();
     MQTT_HELPER::setup(WIFI_HELPER::mqtt_server(),
                        WIFI_HELPER::mqtt_port(),
                        WIFI_HELPER::mqtt_user(),
                        WIFI_HELPER::mqtt_password(),
                        WIFI_HELPER::mqtt_topic_bus_tx(),
-                       WIFI_HELPER::mqtt_topic_bus_rx());
+                       WIFI_HELPER::mqtt_topic_bus_rx(),
+                       WIFI_HELPER::event_mode());
 
-    GDOOR::setRxThreshold(PIN_RX_THRESH, WIFI_HELPER::rx_sensitivity());
-    GDOOR::setup(PIN_TX, PIN_TX_EN, WIFI_HELPER::rx_pin());
+    GDOOR_THRESHOLD::setup(PIN_RX_THRESH, WIFI_HELPER::rx_sensitivity(), WIFI_HELPER::rx_sensitivity_auto());
+    GDOOR::setup(PIN_TX, PIN_TX_EN, WIFI_HELPER::rx_pin(), WIFI_HELPER::rx_pin_secondary());
+    GDOOR::setRxCorrection(WIFI_HELPER::rx_correction());
+    GDOOR_CAPTURE::setup(WIFI_HELPER::rx_pin(), GDOOR_THRESHOLD::voltage());
 
     mqtt_topic_bus_rx = WIFI_HELPER::mqtt_topic_bus_rx();
+    mqtt_topic_diagnostics = WIFI_HELPER::mqtt_topic_diagnostics();
+    GDOOR_DEDUP::setup(WIFI_HELPER::dedup_window());
+    if (!GDOOR_UDP::setup(WIFI_HELPER::udp_target())) {
+        JSONPRINT("Invalid UDP stream target");
+    }
+    if (!GDOOR_UDP::setup_tx(WIFI_HELPER::udp_tx_sender())) {
+        JSONPRINT("Invalid UDP TX sender, UDP TX is disabled");
+    }
+    if (!GDOOR_FILTER::setup(WIFI_HELPER::publish_filter())) {
+        JSONPRINT("Invalid publish filter, publishing all bus data");
+    }
+    GDOOR_DEVICES::setup(WIFI_HELPER::mqtt_topic_devices(), WIFI_HELPER::ha_device_entities());
+    GDOOR_COMMAND::setup();
+    GDOOR_RULES::setup();
     debug = WIFI_HELPER::debug();
+    event_mode = WIFI_HELPER::event_mode();
 
     JSONDEBUG("GDoor Setup done");
     JSONDEBUG("RX Pin: ");
     JSONDEBUG(WIFI_HELPER::rx_pin());
     JSONDEBUG("RX Sensitivity: ");
-    JSONDEBUG(WIFI_HELPER::rx_sensitivity());
+    JSONDEBUG(GDOOR_THRESHOLD::voltage());
 }
 
 void loop() {
+    static uint32_t last_diagnostics = 0;
+    GDOOR_PROFILER::begin_loop();
+
+    GDOOR_PROFILER::section(PROFILE_WIFI);
     WIFI_HELPER::loop();
+    GDOOR_PROFILER::section(PROFILE_STREAMS);
+    GDOOR_LIVE::loop();
+    GDOOR_CAPTURE::loop();
+    GDOOR_PROFILER::section(PROFILE_MQTT);
     MQTT_HELPER::loop();
+    GDOOR_PROFILER::section(PROFILE_GDOOR);
     GDOOR::loop();
+    GDOOR_LATENCY::loop();
+    GDOOR_BUSSTATS::loop();
+    GDOOR_RULES::loop();
     GDOOR_DATA* rx_data = GDOOR::read();
 
+    // Suppress repeated frames (e.g. held ring button), if enabled
+    if(rx_data != NULL && !debug && GDOOR_DEDUP::is_repeat(rx_data)) {
+        JSONDEBUG("Suppressed repeated data from bus");
+        GDOOR_LATENCY::rx_finish();
+        rx_data = NULL;
+    }
+
+    GDOOR_PROFILER::section(PROFILE_OUTPUT);
     // Output bus idle message on new MQTT connections to set a defined state
     if(MQTT_HELPER::isNewConnection()) {
-        output(gdoor_data_idle, mqtt_topic_bus_rx, true);
+        if (!event_mode) {
+            output(gdoor_data_idle, mqtt_topic_bus_rx, true);
+        }
+        GDOOR_DEVICES::republish();
     }
     if(rx_data != NULL) {
         JSONDEBUG("Received data from bus");
         GDOOR_DATA_PROTOCOL busmessage = GDOOR_DATA_PROTOCOL(rx_data);
+        GDOOR_LATENCY::rx_mark(LATENCY_RX_DECODED);
+        GDOOR_RULES::evaluate(rx_data); // Local automations, before the slower MQTT output
         output(busmessage, mqtt_topic_bus_rx);
+        GDOOR_LATENCY::rx_finish();
+        GDOOR_DEVICES::update(busmessage);
         JSONDEBUG("Output bus data via Serial and MQTT, done");
         // Output idle message after bus message, to reset values so that
-        //home automation can trigger again
-        output(gdoor_data_idle, mqtt_topic_bus_rx, true);
+        //home automation can trigger again. Not needed for events.
+        if (!event_mode) {
+            output(gdoor_data_idle, mqtt_topic_bus_rx, true);
+        }
 
     } else if (!GDOOR::active()) { // Neither RX nor TX active,
+        GDOOR_PROFILER::section(PROFILE_INGEST);
+        GDOOR_HISTORY::loop(); // Flash writes only while the bus is idle
+        GDOOR_THRESHOLD::loop();
         String str_received("");
-        if (Serial.available() > 0) { // let's check the serial port if something is in buffer
+        uint32_t received_time = micros();
+        uint8_t tx_data[MAX_WORDLEN];
+        uint16_t tx_len = 0;
+        if (GDOOR_SERIAL::receive(str_received)) {
+            // Command via the framed serial protocol
+        } else if (!GDOOR_SERIAL::binary() && Serial.available() > 0) { // let's check the serial port if something is in buffer
             str_received = Serial.readString();
         } else {
             str_received = MQTT_HELPER::receive();
+            received_time = MQTT_HELPER::receive_time();
         }
         str_received.trim();    
 
         if(str_received.length() > 0) {
             if(!parse(str_received)) { //Check if received string is a command
-                GDOOR::send(str_received); // Send to bus if it is not a command
-                JSONDEBUG("Send: ");
-                JSONDEBUG(str_received);
+                GDOOR_LATENCY::tx_begin(received_time);
+                // Send to bus if it is not a command: macro name, structured command or hex string
+                if(GDOOR_COMMAND::send(str_received)) {
+                    JSONDEBUG("Send: ");
+                    JSONDEBUG(str_received);
+                } else {
+                    JSONDEBUG("Invalid structured command");
+                }
             }
+        } else if (GDOOR_UDP::receive(tx_data, &tx_len) || GDOOR_SERIAL::receive(tx_data, &tx_len)) {
+            // Bus data from the UDP stream or the framed serial protocol
+            GDOOR_LATENCY::tx_begin(micros());
+            GDOOR::send(tx_data, tx_len);
+        } else if (GDOOR_CORRELATION::report_pending()) {
+            // Completion record (acked or timeout) of a request, e.g. DOOR_OPEN
+            output_diagnostics(GDOOR_CORRELATION::printTo);
+        } else if (GDOOR_DEDUP::report_pending()) {
+            // Repeat count of a suppressed frame, belongs to its first published copy
+            output_diagnostics(GDOOR_DEDUP::printTo);
+        } else if (millis() - last_diagnostics >= DIAGNOSTICS_INTERVAL_MS) {
+            // Periodic metrics and bus statistics via MQTT, e.g. to alert on decode error rates
+            GDOOR_PROFILER::section(PROFILE_DIAGNOSTICS);
+            last_diagnostics = millis();
+            output_diagnostics(GDOOR_METRICS::printTo, false);
+            output_diagnostics(GDOOR_BUSSTATS::printTo, false);
+            GDOOR_BUSSTATS::reset_window();
         }
         
     }
+    GDOOR_PROFILER::end_loop();
 }
@@ -34,6 +34,10 @@
 #define BIT_ONE_DIV 2.5
 #define BIT_MIN_LEN 5
 #define STARTBIT_MIN_LEN 45
+#define RX_TIMER_FREQ 120000
+#define RX_BITSTREAM_TIMEOUT (6*STARTBIT_MIN_LEN) // RX_TIMER_FREQ ticks without edge until bitstream is over
+#define RX_CORRECT_CANDIDATES 3 // Bits GDOOR_DATA::correct tries per frame, least confident first
+#define RX_EDGE_MIN_SPACING_US 10 // Closer edges are glitches, carrier period is ~17 us (60 kHz), 0: no filter
 
 // TX
 #define STARTBIT_PULSENUM 66
@@ -52,6 +56,34 @@
 #define DEFAULT_MQTT_PORT     "1883" 
 #define DEFAULT_MQTT_TOPIC_BUS_RX "gdoor/bus_rx"
 #define DEFAULT_MQTT_TOPIC_BUS_TX "gdoor/bus_tx"
+#define DEFAULT_MQTT_TOPIC_DIAGNOSTICS "gdoor/diagnostics"
+#define DEFAULT_MQTT_TOPIC_DEVICES "gdoor/device"
+#define DIAGNOSTICS_INTERVAL_MS 60000
+
+// Publish mode
+#define PUBLISH_MODE_SENSOR_NAME "Sensor (with BUS_IDLE reset)"
+#define PUBLISH_MODE_EVENT_NAME "Event (one message per bus message)"
+#define PUBLISH_MODE_CHOICES {PUBLISH_MODE_SENSOR_NAME, PUBLISH_MODE_EVENT_NAME}
+#define PUBLISH_MODE_CHOICES_LEN 2
+
+// Duplicate suppression
+#define DEFAULT_DEDUP_WINDOW "0"
+
+// UDP stream, empty: disabled
+#define DEFAULT_UDP_TARGET ""
+// UDP TX, bus data is only accepted from this sender IP, empty: disabled
+#define DEFAULT_UDP_TX_SENDER ""
+
+// Publish filter, empty: publish all valid bus data
+#define DEFAULT_PUBLISH_FILTER ""
+#define PUBLISH_FILTER_LEN 120
+
+// Serial port
+#define DEFAULT_SERIAL_BAUD "115200"
+#define SERIAL_PROTOCOL_JSON_NAME "JSON lines"
+#define SERIAL_PROTOCOL_BINARY_NAME "Binary frames (COBS, CRC-16)"
+#define SERIAL_PROTOCOL_CHOICES {SERIAL_PROTOCOL_JSON_NAME, SERIAL_PROTOCOL_BINARY_NAME}
+#define SERIAL_PROTOCOL_CHOICES_LEN 2
 
 // Settings
 
@@ -72,8 +104,14 @@
 #define RX_PIN_32_NAME "v3.0 (IO32)"
 #define RX_PIN_32_NUM 32
 
-#define RX_PIN_CHOICES {RX_PIN_22_NAME, RX_PIN_21_NAME, RX_PIN_12_NAME, RX_PIN_32_NAME}
-#define RX_PIN_CHOICES_LEN 4
+// Both v3.1 inputs, decoded in parallel
+#define RX_PIN_DIVERSITY_NAME "v3.1 diversity (IO22 + IO21)"
+
+#define RX_PIN_NONE 0xFF
+#define RX_CHANNELS_MAX 2
+
+#define RX_PIN_CHOICES {RX_PIN_22_NAME, RX_PIN_21_NAME, RX_PIN_12_NAME, RX_PIN_32_NAME, RX_PIN_DIVERSITY_NAME}
+#define RX_PIN_CHOICES_LEN 5
 
 // RX Pin Sensitivity (only working for RX PIN22)
 #define RX_SENS_LOW_NAME "Low (1.3V)"
@@ -83,7 +121,10 @@
 #define RX_SENS_HIGH_NAME "High (1.65V)"
 #define RX_SENS_HIGH_NUM 1.65
 
-#define RX_SENS_CHOICES {RX_SENS_HIGH_NAME, RX_SENS_MED_NAME, RX_SENS_LOW_NAME}
-#define RX_SENS_CHOICES_LEN 3
+// Calibrated and adapted while running, IO21 is decoded in parallel as reference
+#define RX_SENS_AUTO_NAME "Auto (calibrated, IO22 + IO21)"
+
+#define RX_SENS_CHOICES {RX_SENS_HIGH_NAME, RX_SENS_MED_NAME, RX_SENS_LOW_NAME, RX_SENS_AUTO_NAME}
+#define RX_SENS_CHOICES_LEN 4
 
 #endif
\ No newline at end of file
@@ -16,16 +16,24 @@
  */
 #include "gdoor.h"
 
+// Build check of a second bus interface, which the adapter itself does not use,
+// so that instance specific code (ISR trampolines, primary-only hooks) keeps compiling.
+template class GDOOR_RX<GDOOR_CONFIG, 1>;
+template class GDOOR_TX<GDOOR_CONFIG, 1>;
+template class GDOOR_ENGINE<GDOOR_CONFIG, 1>;
+
 namespace GDOOR {
+    GDOOR_ENGINE<GDOOR_CONFIG, 0> engine;
+
     /*
     * Setup everything needed for GDoor.
     * @param int txpin Pin number where PWM is created when sending out data
     * @param int txenpin Pin number where output buffer is turned on/off
     * @param int rxpin Pin number where pulses from bus are received
+    * @param int rxpin_secondary Second RX pin for diversity reception, RX_PIN_NONE: not used
     */
-    void setup(uint8_t txpin, uint8_t txenpin, uint8_t rxpin) {
-        GDOOR_RX::setup(rxpin);
-        GDOOR_TX::setup(txpin, txenpin);
+    void setup(uint8_t txpin, uint8_t txenpin, uint8_t rxpin, uint8_t rxpin_secondary) {
+        engine.setup(txpin, txenpin, rxpin, rxpin_secondary);
     }
 
     /*
@@ -33,7 +41,7 @@ namespace GDOOR {
     * Needed for the decoding logic.
     */
     void loop() {
-        GDOOR_RX::loop();
+        engine.loop();
     }
 
     /**
@@ -41,7 +49,7 @@ namespace GDOOR {
     * @return Data pointer as GDOOR_RX_DATA class or NULL if no data is available
     */
     GDOOR_DATA* read() {
-        return GDOOR_RX::read();
+        return engine.read();
     }
 
     /*
@@ -50,7 +58,7 @@ namespace GDOOR {
     * @param len length of buffer, can be max MAX_WORDLEN
     */
     void send(uint8_t *data, uint16_t len) {
-        GDOOR_TX::send(data, len);
+        engine.send(data, len);
     }
 
     /*
@@ -58,7 +66,7 @@ namespace GDOOR {
     * @param hex string data without 0x prefix
     */
     void send(String str) {
-        GDOOR_TX::send(str);
+        engine.send(str);
     }
 
     /*
@@ -66,7 +74,12 @@ namespace GDOOR {
     * @return true: GDOOR RX or TX is active. False: no GDOOR activity.
     */
     bool active() {
-        return (GDOOR_TX::tx_state != 0 || GDOOR_RX::rx_state != 0);
+        return engine.active();
+    }
+
+    /** Enable/disable the correction of frames with a single parity error */
+    void setRxCorrection(bool enabled) {
+        engine.rx.set_correction(enabled);
     }
 
     /** Set RX Threshold (Sensitivity) to a certain level,
@@ -74,6 +87,11 @@ namespace GDOOR {
     */
    void setRxThreshold(uint8_t pin, float sensitivity) {
         uint8_t value =  (uint8_t)((sensitivity/3.3)*255);
+        setRxThresholdDac(pin, value);
+   }
+
+    /** Set RX Threshold as raw DAC value (0-255 for 0-3.3V) */
+   void setRxThresholdDac(uint8_t pin, uint8_t value) {
         dacWrite(pin, value);
    }
 }
\ No newline at end of file
@@ -22,15 +22,65 @@
 #include "gdoor_rx.h"
 #include "gdoor_tx.h"
 #include "gdoor_data.h"
+#include "gdoor_config.h"
+
+/*
+* One bus interface, RX and TX.
+* Every INSTANCE uses 2 of the 4 hardware timers (RX bitstream timeout, TX pulses),
+* so a chip can drive two buses, e.g. in a multi-entrance building:
+*
+*   GDOOR_ENGINE<GDOOR_CONFIG, 1> second_bus;
+*   second_bus.setup(PIN_TX_2, PIN_TX_EN_2, PIN_RX_2);
+*
+* Only instance 0, the GDOOR namespace below, feeds the diagnostics
+* (metrics, ISR profiling, latency, bus statistics, history, ...),
+* other instances run without them, so counters never mix two buses.
+* @param CONFIG timings and buffer sizes, see gdoor_config.h
+* @param INSTANCE number of the bus interface, one object per INSTANCE
+*/
+template<class CONFIG, uint8_t INSTANCE>
+class GDOOR_ENGINE {
+    public:
+        GDOOR_RX<CONFIG, INSTANCE> rx;
+        GDOOR_TX<CONFIG, INSTANCE> tx;
+
+        void setup(uint8_t txpin, uint8_t txenpin, uint8_t rxpin, uint8_t rxpin_secondary = RX_PIN_NONE) {
+            rx.setup(rxpin, rxpin_secondary);
+            tx.setup(txpin, txenpin, &rx);
+        }
+
+        void loop() {
+            rx.loop();
+        }
+
+        GDOOR_DATA* read() {
+            return rx.read();
+        }
+
+        void send(uint8_t *data, uint16_t len) {
+            tx.send(data, len);
+        }
+
+        void send(String str) {
+            tx.send(str);
+        }
+
+        bool active() {
+            return (tx.tx_state != 0 || rx.rx_state != 0);
+        }
+};
 
 namespace GDOOR { //Namespace as we can only use it once
-    void setup(uint8_t txpin, uint8_t txenpin, uint8_t rxpin);
+    extern GDOOR_ENGINE<GDOOR_CONFIG, 0> engine; // Bus interface of the adapter
+    void setup(uint8_t txpin, uint8_t txenpin, uint8_t rxpin, uint8_t rxpin_secondary = RX_PIN_NONE);
     void loop();
     GDOOR_DATA* read();
     void send(uint8_t *data, uint16_t len);
     void send(String str);
     bool active();
     void setRxThreshold(uint8_t pin, float sensitivity);
+    void setRxThresholdDac(uint8_t pin, uint8_t value);
+    void setRxCorrection(bool enabled);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,287 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "defines.h"
+#include "gdoor_busstats.h"
+#include "gdoor_histogram.h"
+#include "gdoor_utils.h"
+#include "gdoor.h"
+
+// RX end of frame is detected RX_BITSTREAM_TIMEOUT after the last edge
+#define RX_END_DELAY_US ((uint32_t)(RX_BITSTREAM_TIMEOUT*1000000ULL/RX_TIMER_FREQ))
+
+namespace GDOOR_BUSSTATS {
+    struct second_slot { // Bus activity within one second
+        uint32_t busy_us;
+        uint32_t tx_busy_us;
+        uint16_t bursts; // Received bursts, parsed or not
+        uint16_t frames; // Received bursts which could be parsed
+        uint16_t tx_frames;
+    };
+
+    struct source_entry { // Frame counts per source address and action
+        uint8_t source[3];
+        uint8_t action;
+        uint32_t rx;
+        uint32_t tx;
+    };
+
+    // Sliding window, one slot per second, slots[second % BUSSTATS_WINDOW_S]
+    second_slot slots[BUSSTATS_WINDOW_S];
+    uint32_t current_second = 0;
+
+    // Distributions, collected since reset_window()
+    GDOOR_HISTOGRAM gaps_ms; // Time between end of a frame and start of the next one
+    GDOOR_HISTOGRAM durations_us; // Frame length in time
+    uint32_t words[MAX_WORDLEN+2]; // Frame length in words (incl. checksum)
+    source_entry sources[BUSSTATS_MAX_SOURCES];
+    uint8_t sources_len = 0;
+    uint32_t sources_other = 0; // Frames which did not fit into sources anymore
+    uint32_t window_start = 0; // millis() of reset_window()
+
+    uint32_t last_frame_end = 0; // Timestamp (us) of last frame end, 0 before first frame
+    uint32_t last_tx_end = 0; // Last seen GDOOR::engine.tx.tx_end_time
+
+    /*
+    * Internal function which moves the sliding window to the current second
+    * and returns the slot of the current second.
+    */
+    second_slot& slot() {
+        uint32_t now = millis()/1000;
+        if (now - current_second >= BUSSTATS_WINDOW_S) { // Nothing happened for a whole window
+            memset(slots, 0, sizeof(slots));
+            current_second = now;
+        }
+        while (current_second != now) {
+            current_second++;
+            memset(&slots[current_second % BUSSTATS_WINDOW_S], 0, sizeof(second_slot));
+        }
+        return slots[current_second % BUSSTATS_WINDOW_S];
+    }
+
+    /*
+    * Internal function which counts one bus frame of a source/action pair.
+    */
+    void count_source(uint8_t *data, uint16_t len, bool tx) {
+        if (len < 6) {
+            return;
+        }
+        source_entry *entry = NULL;
+        for (uint8_t i=0; i<sources_len; i++) {
+            if (sources[i].action == data[2] && !memcmp(sources[i].source, &data[3], 3)) {
+                entry = &sources[i];
+                break;
+            }
+        }
+        if (entry == NULL) {
+            if (sources_len >= BUSSTATS_MAX_SOURCES) {
+                sources_other++;
+                return;
+            }
+            entry = &sources[sources_len++];
+            memcpy(entry->source, &data[3], 3);
+            entry->action = data[2];
+            entry->rx = 0;
+            entry->tx = 0;
+        }
+        if (tx) {
+            entry->tx++;
+        } else {
+            entry->rx++;
+        }
+    }
+
+    /*
+    * Internal function which adds the timing of one bus frame.
+    */
+    void count_frame(uint32_t start, uint32_t end, bool tx) {
+        uint32_t duration = end - start;
+        second_slot &s = slot();
+
+        if (last_frame_end != 0 && (int32_t)(start - last_frame_end) > 0) {
+            gaps_ms.add((start - last_frame_end)/1000);
+        }
+        last_frame_end = end;
+        durations_us.add(duration);
+
+        if (tx) {
+            s.tx_busy_us += duration;
+            s.tx_frames++;
+        } else {
+            s.busy_us += duration;
+            s.bursts++;
+        }
+    }
+
+    /*
+    * Add the airtime of a received burst, called before parsing,
+    * so that noise and broken frames also count toward the utilization.
+    * @param start Timestamp (us) of first edge
+    * @param end Timestamp (us) when burst was detected as over
+    */
+    void rx_burst(uint32_t start, uint32_t end) {
+        end = end - RX_END_DELAY_US;
+        if ((int32_t)(end - start) < 0) {
+            end = start;
+        }
+        count_frame(start, end, false);
+    }
+
+    /*
+    * Add a received bus frame, its airtime was already added by rx_burst().
+    * @param data Parsed bus frame
+    */
+    void rx_frame(GDOOR_DATA *data) {
+        slot().frames++;
+        words[data->len <= MAX_WORDLEN+1 ? data->len : MAX_WORDLEN+1]++;
+        if (data->valid) {
+            count_source(data->data, data->len, false);
+        }
+    }
+
+    /*
+    * Add a bus frame, which is send out by us.
+    * Timing is collected in loop() as soon as it was sent.
+    * @param data buffer with bus data
+    * @param len length of buffer (without checksum)
+    */
+    void tx_frame(uint8_t *data, uint16_t len) {
+        words[len+1 <= MAX_WORDLEN+1 ? len+1 : MAX_WORDLEN+1]++;
+        count_source(data, len, true);
+    }
+
+    /*
+    * Needs to be called in main loop(),
+    * collects the timing of sent bus frames.
+    */
+    void loop() {
+        uint32_t tx_end = GDOOR::engine.tx.tx_end_time;
+        if (tx_end != last_tx_end) {
+            last_tx_end = tx_end;
+            if (GDOOR::engine.tx.tx_start_time != 0) {
+                count_frame(GDOOR::engine.tx.tx_start_time, tx_end, true);
+            }
+        }
+    }
+
+    /*
+    * Start a new window for the distributions and source counts,
+    * utilization and frame rate always cover the last BUSSTATS_WINDOW_S seconds.
+    */
+    void reset_window() {
+        gaps_ms.reset();
+        durations_us.reset();
+        memset(words, 0, sizeof(words));
+        sources_len = 0;
+        sources_other = 0;
+        window_start = millis();
+    }
+
+    /*
+    * Json compatible output of the bus statistics,
+    * "busstats": {"utilization_percent": "x", ..., "sources": [...]}
+    */
+    size_t printTo(Print& p) {
+        uint32_t busy = 0;
+        uint32_t tx_busy = 0;
+        uint32_t bursts = 0;
+        uint32_t frames = 0;
+        uint32_t tx_frames = 0;
+        float peak = 0;
+
+        slot(); // Move window to now
+        for (uint8_t i=0; i<BUSSTATS_WINDOW_S; i++) {
+            busy += slots[i].busy_us;
+            tx_busy += slots[i].tx_busy_us;
+            bursts += slots[i].bursts;
+            frames += slots[i].frames;
+            tx_frames += slots[i].tx_frames;
+            float utilization = (slots[i].busy_us + slots[i].tx_busy_us)/10000.0;
+            if (utilization > peak) {
+                peak = utilization;
+            }
+        }
+
+        // Window covers the current (partial) second and the full seconds before
+        uint32_t now = millis();
+        uint32_t window_ms = (BUSSTATS_WINDOW_S-1)*1000 + now%1000;
+        if (window_ms > now) {
+            window_ms = now;
+        }
+        if (window_ms == 0) {
+            window_ms = 1;
+        }
+
+        size_t r = 0;
+        r+= p.print("\"busstats\": {");
+        r+= GDOOR_UTILS::print_json_value<uint32_t>(p, "window_s", BUSSTATS_WINDOW_S);
+        r+= p.print(", ");
+        r+= GDOOR_UTILS::print_json_value<float>(p, "utilization_percent", (busy + tx_busy)/(window_ms*10.0));
+        r+= p.print(", ");
+        r+= GDOOR_UTILS::print_json_value<float>(p, "peak_utilization_percent", peak);
+        r+= p.print(", ");
+        r+= GDOOR_UTILS::print_json_value<float>(p, "tx_utilization_percent", tx_busy/(window_ms*10.0));
+        r+= p.print(", ");
+        r+= GDOOR_UTILS::print_json_value<float>(p, "tx_share_percent", busy + tx_busy ? tx_busy*100.0/(busy + tx_busy) : 0.0);
+        r+= p.print(", ");
+        r+= GDOOR_UTILS::print_json_value<float>(p, "frames_per_second", (frames + tx_frames)*1000.0/window_ms);
+        r+= p.print(", ");
+        r+= GDOOR_UTILS::print_json_value<float>(p, "tx_frames_per_second", tx_frames*1000.0/window_ms);
+        r+= p.print(", ");
+        r+= GDOOR_UTILS::print_json_value<uint32_t>(p, "unparsed_bursts", bursts > frames ? bursts - frames : 0);
+        r+= p.print(", ");
+
+        r+= GDOOR_UTILS::print_json_value<uint32_t>(p, "distribution_s", (now - window_start)/1000);
+        r+= p.print(", \"gap_ms\": {");
+        r+= p.print(gaps_ms);
+        r+= p.print("}, \"duration_us\": {");
+        r+= p.print(durations_us);
+        r+= p.print("}, \"words\": {");
+        bool first = true;
+        for (uint8_t i=0; i<=MAX_WORDLEN+1; i++) {
+            if (words[i]) {
+                if (!first) {
+                    r+= p.print(", ");
+                }
+                first = false;
+                r+= GDOOR_UTILS::print_json_value<uint32_t>(p, String(i).c_str(), words[i]);
+            }
+        }
+        r+= p.print("}, \"sources\": [");
+        for (uint8_t i=0; i<sources_len; i++) {
+            const char *action = "ACTION_UNKOWN";
+            if (GDOOR_DATA_ACTION.find(sources[i].action) != GDOOR_DATA_ACTION.end()) {
+                action = GDOOR_DATA_ACTION.at(sources[i].action);
+            }
+            r+= p.print("{");
+            r+= GDOOR_UTILS::print_json_hexstring<uint8_t>(p, "source", sources[i].source, 3);
+            r+= p.print(", ");
+            r+= GDOOR_UTILS::print_json_string(p, "action", action);
+            r+= p.print(", ");
+            r+= GDOOR_UTILS::print_json_value<uint32_t>(p, "rx", sources[i].rx);
+            r+= p.print(", ");
+            r+= GDOOR_UTILS::print_json_value<uint32_t>(p, "tx", sources[i].tx);
+            r+= p.print("}");
+            if (i < sources_len-1) {
+                r+= p.print(", ");
+            }
+        }
+        r+= p.print("], ");
+        r+= GDOOR_UTILS::print_json_value<uint32_t>(p, "sources_other", sources_other);
+        r+= p.print("}");
+        return r;
+    }
+}
@@ -0,0 +1,34 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GDOOR_BUSSTATS_H
+#define GDOOR_BUSSTATS_H
+#include <Arduino.h>
+#include "gdoor_data.h"
+
+#define BUSSTATS_WINDOW_S 60 // Sliding window for utilization and frame rate
+#define BUSSTATS_MAX_SOURCES 12 // Max. number of tracked source/action pairs per window, limited by MQTT_PRINTER buffer
+
+namespace GDOOR_BUSSTATS { //Namespace as we can only use it once
+    void rx_burst(uint32_t start, uint32_t end);
+    void rx_frame(GDOOR_DATA *data);
+    void tx_frame(uint8_t *data, uint16_t len);
+    void loop();
+    void reset_window();
+    size_t printTo(Print& p);
+};
+
+#endif
@@ -0,0 +1,162 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <WiFi.h>
+#include "defines.h"
+#include "gdoor_config.h"
+#include "gdoor_capture.h"
+#include "gdoor_sinks.h"
+#include "gdoor_serial.h"
+
+namespace GDOOR_CAPTURE {
+    enum capture_mode {
+        CAPTURE_OFF,
+        CAPTURE_TCP,
+        CAPTURE_SERIAL
+    };
+
+    capture_mode mode = CAPTURE_OFF;
+    WiFiServer server(CAPTURE_TCP_PORT);
+    WiFiClient client;
+    bool server_started = false;
+    uint8_t header[CAPTURE_HEADER_LEN];
+
+    /*
+    * Internal function, stores a little endian value.
+    */
+    void put(uint8_t *buffer, uint32_t value, uint8_t len) {
+        for (uint8_t i=0; i<len; i++) {
+            buffer[i] = value >> (8*i);
+        }
+    }
+
+    /*
+    * Prepares the capture file header with adapter id and RX settings.
+    * @param rx_pin RX input pin
+    * @param rx_sensitivity RX comparator threshold (V), IO22 only
+    */
+    void setup(uint8_t rx_pin, float rx_sensitivity) {
+        memset(header, 0, sizeof(header));
+        memcpy(header, CAPTURE_MAGIC, 8);
+        put(&header[8], CAPTURE_VERSION, 2);
+        put(&header[10], CAPTURE_HEADER_LEN, 2);
+        WiFi.macAddress(&header[12]); // Adapter id, 6 bytes
+        header[18] = rx_pin;
+        uint32_t sensitivity;
+        memcpy(&sensitivity, &rx_sensitivity, 4); // IEEE 754 float
+        put(&header[20], sensitivity, 4);
+        put(&header[24], GDOOR_CONFIG::tx_pulse_freq, 4); // Counts are carrier pulses per bit
+    }
+
+    /*
+    * Internal function, writes to the active capture output.
+    */
+    void write(const uint8_t *buffer, uint16_t len) {
+        if (mode == CAPTURE_TCP && client.connected()) {
+            client.write(buffer, len);
+        } else if (mode == CAPTURE_SERIAL && GDOOR_SERIAL::binary()) {
+            GDOOR_SERIAL::send(SERIAL_MSG_CAPTURE, buffer, len);
+        } else if (mode == CAPTURE_SERIAL) {
+            Serial.write(buffer, len);
+        }
+    }
+
+    /*
+    * Internal function, starts a capture stream with the file header,
+    * the unix time of the start is filled in, if known.
+    */
+    void write_header() {
+        time_t t = time(NULL);
+        put(&header[28], t > 1600000000 ? (uint32_t)t : 0, 4);
+        write(header, CAPTURE_HEADER_LEN);
+    }
+
+    /*
+    * Switch capture mode.
+    * Serial capture mutes the json output on Serial, debug mode should be off.
+    * With the framed serial protocol, the stream is send as SERIAL_MSG_CAPTURE
+    * and other output continues.
+    * @param new_mode "tcp" (port CAPTURE_TCP_PORT), "serial" or "off"
+    * @return false if mode is unknown
+    */
+    bool set_mode(const String &new_mode) {
+        if (new_mode == "tcp") {
+            mode = CAPTURE_TCP;
+        } else if (new_mode == "serial") {
+            mode = CAPTURE_SERIAL;
+        } else if (new_mode == "off") {
+            mode = CAPTURE_OFF;
+        } else {
+            return false;
+        }
+        if (mode != CAPTURE_TCP && client) {
+            client.stop();
+        }
+        GDOOR_SINKS::serial.enabled = (mode != CAPTURE_SERIAL || GDOOR_SERIAL::binary());
+        if (mode == CAPTURE_SERIAL) {
+            write_header();
+        }
+        return true;
+    }
+
+    /*
+    * Needs to be called in main loop(),
+    * accepts a TCP capture client, a new client replaces the old one.
+    */
+    void loop() {
+        if (mode != CAPTURE_TCP || WiFi.status() != WL_CONNECTED) {
+            return;
+        }
+        if (!server_started) {
+            server.begin();
+            server_started = true;
+        }
+        if (server.hasClient()) {
+            if (client) {
+                client.stop();
+            }
+            client = server.accept();
+            client.setNoDelay(true);
+            write_header();
+        }
+    }
+
+    /*
+    * Writes one bitstream record, called by GDOOR_RX
+    * with the pulse counts as seen before parsing.
+    * @param counts pulse counts, carrier edges per bit
+    * @param len number of counts
+    * @param timestamp micros() of first edge
+    * @param flags CAPTURE_FLAG_*
+    */
+    void record(const uint16_t *counts, uint16_t len, uint32_t timestamp, uint16_t flags) {
+        static uint8_t buffer[CAPTURE_RECORD_HEADER_LEN + MAX_WORDLEN*9*2 + 2];
+        if (mode == CAPTURE_OFF || (mode == CAPTURE_TCP && !client.connected())) {
+            return;
+        }
+        uint16_t record_len = (CAPTURE_RECORD_HEADER_LEN + len*2 + 3) & ~3;
+        put(&buffer[0], CAPTURE_RECORD_BITSTREAM, 2);
+        put(&buffer[2], record_len, 2);
+        put(&buffer[4], timestamp, 4);
+        put(&buffer[8], len, 2);
+        put(&buffer[10], flags, 2);
+        for (uint16_t i=0; i<len; i++) {
+            put(&buffer[CAPTURE_RECORD_HEADER_LEN + 2*i], counts[i], 2);
+        }
+        memset(&buffer[CAPTURE_RECORD_HEADER_LEN + len*2], 0, record_len - CAPTURE_RECORD_HEADER_LEN - len*2);
+        write(buffer, record_len);
+    }
+}
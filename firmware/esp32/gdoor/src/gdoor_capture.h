@@ -0,0 +1,41 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GDOOR_CAPTURE_H
+#define GDOOR_CAPTURE_H
+#include <Arduino.h>
+
+#define CAPTURE_TCP_PORT 5072
+
+// Capture format, little endian, see software/gdoor-capture/README.md.
+// File header, followed by records. Record length is a multiple of 4.
+#define CAPTURE_MAGIC "GDOORCAP"
+#define CAPTURE_VERSION 1
+#define CAPTURE_HEADER_LEN 32
+#define CAPTURE_RECORD_HEADER_LEN 12
+#define CAPTURE_RECORD_BITSTREAM 1
+#define CAPTURE_FLAG_PARSED 0x01 // GDOOR_DATA::parse found at least one word
+#define CAPTURE_FLAG_VALID 0x02 // Parity and checksum ok
+#define CAPTURE_FLAG_SECONDARY 0x04 // Secondary RX input, diversity mode
+
+namespace GDOOR_CAPTURE { //Namespace as we can only use it once
+    void setup(uint8_t rx_pin, float rx_sensitivity);
+    void loop();
+    bool set_mode(const String &mode);
+    void record(const uint16_t *counts, uint16_t len, uint32_t timestamp, uint16_t flags);
+};
+
+#endif
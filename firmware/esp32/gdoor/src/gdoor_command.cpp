@@ -0,0 +1,297 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <LittleFS.h>
+#include "gdoor_command.h"
+#include "gdoor.h"
+#include "gdoor_data.h"
+#include "gdoor_metrics.h"
+#include "gdoor_utils.h"
+#include "printer_helper.h"
+
+namespace GDOOR_COMMAND { //Namespace as we can only use it once
+
+    struct macro {
+        String name;
+        String command;
+        uint8_t data[MAX_WORDLEN]; // Pre-encoded bus data, sent as is on trigger
+        uint16_t len;
+    };
+
+    macro macros[COMMAND_MACROS_MAX];
+    uint8_t macro_count = 0;
+
+    /**
+     * Internal function, decodes encoded bus data again
+     * and compares it against the requested fields.
+     * Guards against encoder bugs sending wrong data to the bus.
+     * @param data encoded bus data, without checksum
+     * @param len length of data
+     * @param expected requested fields
+     * @param with_destination true: compare destination too
+     * @return true if decoding returned the requested fields
+    */
+    bool roundtrip(const uint8_t *data, uint16_t len, GDOOR_DATA_PROTOCOL &expected, bool with_destination) {
+        static GDOOR_DATA frame; // Static, too large for the stack
+        memcpy(frame.data, data, len);
+        frame.data[len] = GDOOR_UTILS::crc(frame.data, len);
+        frame.len = len + 1;
+        frame.valid = 1;
+
+        GDOOR_DATA_PROTOCOL decoded(&frame);
+        return strcmp(decoded.action, expected.action) == 0
+            && strcmp(decoded.type, expected.type) == 0
+            && memcmp(decoded.source, expected.source, 3) == 0
+            && memcmp(decoded.parameters, expected.parameters, 2) == 0
+            && (!with_destination || memcmp(decoded.destination, expected.destination, 3) == 0);
+    }
+
+    /**
+     * Internal function, reads a hex value from a structured command
+     * into a fixed size field.
+     * @return true if key is missing or its value has exactly len bytes
+    */
+    bool hex_field(const String &command, const char *keyname, uint8_t *field, uint16_t len, bool *found = NULL) {
+        String value;
+        if (found != NULL) {
+            *found = false;
+        }
+        if (!GDOOR_UTILS::json_value(command, keyname, value)) {
+            return true;
+        }
+        if (found != NULL) {
+            *found = true;
+        }
+        return GDOOR_UTILS::parse_hexstring(value, field, len) == len;
+    }
+
+    /**
+     * Internal function, finds a macro by name.
+     * @return index into macros, -1 if not found
+    */
+    int find_macro(const String &name) {
+        for(uint8_t i=0; i<macro_count; i++) {
+            if (macros[i].name == name) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    /**
+     * Encodes a structured command into bus data.
+     * Structured commands are flat json objects, e.g.
+     * {"action": "DOOR_OPEN", "type": "INDOOR", "source": "A286B1", "destination": "5C8D47", "parameters": "0000"}
+     * "parameters" and "destination" are optional, "header" may overwrite
+     * the two leading bytes. A macro name returns the pre-encoded macro data,
+     * any other command is treated as a hex string.
+     * @param command macro name, structured command or hex string
+     * @param data output buffer
+     * @param maxlen size of output buffer, at least 12 bytes
+     * @return number of bytes, -1 if the command is invalid
+    */
+    int16_t encode(const String &command, uint8_t *data, uint16_t maxlen) {
+        int index = find_macro(command);
+        if (index >= 0 && macros[index].len <= maxlen) {
+            memcpy(data, macros[index].data, macros[index].len);
+            return macros[index].len;
+        }
+        if (!command.startsWith("{")) {
+            return GDOOR_UTILS::parse_hexstring(command, data, maxlen);
+        }
+
+        String action;
+        String type;
+        GDOOR_DATA_PROTOCOL fields(NULL);
+        bool with_destination = false;
+        bool source_found = false;
+        uint8_t header[2];
+        bool header_found = false;
+
+        if (!GDOOR_UTILS::json_value(command, "action", action)
+            || !GDOOR_UTILS::json_value(command, "type", type)
+            || !hex_field(command, "source", fields.source, 3, &source_found) || !source_found
+            || !hex_field(command, "parameters", fields.parameters, 2)
+            || !hex_field(command, "destination", fields.destination, 3, &with_destination)
+            || !hex_field(command, "header", header, 2, &header_found)) {
+            return -1;
+        }
+        fields.action = action.c_str();
+        fields.type = type.c_str();
+
+        uint16_t len = fields.encode(data, with_destination);
+        if (len == 0 || !roundtrip(data, len, fields, with_destination)) {
+            return -1;
+        }
+        if (header_found) {
+            data[0] = header[0];
+            data[1] = header[1];
+        }
+        return len;
+    }
+
+    /**
+     * Internal function, adds or replaces a macro
+     * and pre-encodes its command.
+     * @param name macro name, must not be a valid hex string
+     * @param command structured command or hex string
+     * @return true if the command could be encoded
+    */
+    bool add_macro(const String &name, const String &command) {
+        uint8_t data[MAX_WORDLEN];
+        if (name.length() == 0 || name.startsWith("*") || name.startsWith("{")
+            || GDOOR_UTILS::parse_hexstring(name, data, MAX_WORDLEN) >= 0) {
+            return false;
+        }
+        int16_t len = encode(command, data, MAX_WORDLEN);
+        if (len <= 0) {
+            return false;
+        }
+
+        int index = find_macro(name);
+        if (index < 0) {
+            if (macro_count >= COMMAND_MACROS_MAX) {
+                return false;
+            }
+            index = macro_count++;
+        }
+        macros[index].name = name;
+        macros[index].command = command;
+        memcpy(macros[index].data, data, len);
+        macros[index].len = len;
+        return true;
+    }
+
+    /**
+     * Internal function, writes all macros to LittleFS.
+    */
+    void save_macros() {
+        if (LittleFS.begin(true)) {
+            File file = LittleFS.open(COMMAND_MACROS_FILE, FILE_WRITE, true);
+            if (file) {
+                for(uint8_t i=0; i<macro_count; i++) {
+                    file.print(macros[i].name);
+                    file.print(" ");
+                    file.println(macros[i].command);
+                }
+                file.close();
+            }
+            LittleFS.end();
+        }
+    }
+
+    /**
+     * Loads stored macros from LittleFS and
+     * pre-encodes them, so triggering a macro needs no parsing.
+    */
+    void setup() {
+        macro_count = 0;
+        if (LittleFS.begin(true)) {
+            File file = LittleFS.open(COMMAND_MACROS_FILE, FILE_READ);
+            if (file && !file.isDirectory()) {
+                while (file.available()) {
+                    String line = file.readStringUntil('\n');
+                    line.trim();
+                    int split = line.indexOf(' ');
+                    if (split > 0 && !add_macro(line.substring(0, split), line.substring(split + 1))) {
+                        JSONDEBUG("Invalid stored command macro");
+                    }
+                }
+                file.close();
+            }
+            LittleFS.end();
+        }
+    }
+
+    /**
+     * Sends a command to the bus.
+     * @param command macro name, structured command or hex string
+     * @return false if the command is invalid
+    */
+    bool send(const String &command) {
+        int index = find_macro(command);
+        if (index >= 0) {
+            GDOOR::send(macros[index].data, macros[index].len);
+            return true;
+        }
+        if (!command.startsWith("{")) {
+            GDOOR::send(command); // Hex string, parsed by GDOOR_TX
+            return true;
+        }
+
+        uint8_t data[MAX_WORDLEN];
+        int16_t len = encode(command, data, MAX_WORDLEN);
+        if (len <= 0) {
+            GDOOR_METRICS::inc(GDOOR_METRICS::TX_REJECTED);
+            return false;
+        }
+        GDOOR::send(data, len);
+        return true;
+    }
+
+    /**
+     * Stores a macro, which is later triggered by sending its name.
+     * @param definition "<name> <command>", command is a structured command or hex string
+     * @return false if name or command are invalid or no macro slot is left
+    */
+    bool define_macro(const String &definition) {
+        int split = definition.indexOf(' ');
+        if (split <= 0) {
+            return false;
+        }
+        String command = definition.substring(split + 1);
+        command.trim();
+        if (!add_macro(definition.substring(0, split), command)) {
+            return false;
+        }
+        save_macros();
+        return true;
+    }
+
+    /**
+     * Removes a stored macro.
+     * @param name macro name
+     * @return false if no macro with this name exists
+    */
+    bool delete_macro(const String &name) {
+        int index = find_macro(name);
+        if (index < 0) {
+            return false;
+        }
+        for(uint8_t i=index; i+1<macro_count; i++) {
+            macros[i] = macros[i+1];
+        }
+        macro_count--;
+        save_macros();
+        return true;
+    }
+
+    /**
+     * Prints all macros with their pre-encoded bus data, json formatted.
+    */
+    size_t printTo(Print& p) {
+        size_t r = 0;
+        r+= p.print("\"macros\": {");
+        for(uint8_t i=0; i<macro_count; i++) {
+            if (i > 0) {
+                r+= p.print(", ");
+            }
+            r+= GDOOR_UTILS::print_json_hexstring<uint8_t>(p, macros[i].name.c_str(), macros[i].data, macros[i].len);
+        }
+        r+= p.print("}");
+        return r;
+    }
+}
@@ -0,0 +1,34 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GDOOR_COMMAND_H
+#define GDOOR_COMMAND_H
+#include <Arduino.h>
+#include "defines.h"
+
+#define COMMAND_MACROS_MAX 16 // Number of stored command macros
+#define COMMAND_MACROS_FILE "/command_macros" // LittleFS file, one "<name> <command>" per line
+
+namespace GDOOR_COMMAND { //Namespace as we can only use it once
+    void setup();
+    int16_t encode(const String &command, uint8_t *data, uint16_t maxlen);
+    bool send(const String &command);
+    bool define_macro(const String &definition);
+    bool delete_macro(const String &name);
+    size_t printTo(Print& p);
+};
+
+#endif
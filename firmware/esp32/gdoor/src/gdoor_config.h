@@ -0,0 +1,56 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GDOOR_CONFIG_H
+#define GDOOR_CONFIG_H
+#include <cstdint>
+#include "defines.h"
+
+/*
+* Timings and buffer sizes of a GDoor engine (GDOOR_RX, GDOOR_TX),
+* the template parameter CONFIG. Defaults are the defines of defines.h,
+* a bus with other timings derives and overwrites single values, e.g.
+*
+*   struct GDOOR_CONFIG_SHORT_FRAMES : GDOOR_CONFIG {
+*       static constexpr uint8_t max_wordlen = 16;
+*   };
+*/
+struct GDOOR_CONFIG {
+    // Buffers, max. frame length in words
+    static constexpr uint8_t max_wordlen = MAX_WORDLEN;
+
+    // RX, pulse counts of the 60kHz carrier
+    static constexpr float bit_one_div = BIT_ONE_DIV;
+    static constexpr uint16_t bit_min_len = BIT_MIN_LEN;
+    static constexpr uint16_t startbit_min_len = STARTBIT_MIN_LEN;
+    static constexpr uint8_t correct_candidates = RX_CORRECT_CANDIDATES;
+
+    // RX, edge timing
+    static constexpr uint32_t rx_timer_freq = RX_TIMER_FREQ;
+    static constexpr uint32_t rx_bit_timeout = 20; // rx_timer_freq ticks without edge until bit is over (=10 60kHz Cycles)
+    static constexpr uint32_t rx_bitstream_timeout = RX_BITSTREAM_TIMEOUT;
+    static constexpr uint32_t rx_edge_min_spacing_us = RX_EDGE_MIN_SPACING_US;
+
+    // TX
+    static constexpr uint32_t tx_pulse_freq = 60000; // Pulses are counted with this frequency
+    static constexpr uint32_t tx_carrier_freq = 52000; // PWM, bandpass tolerances are on the lower side
+    static constexpr uint16_t startbit_pulsenum = STARTBIT_PULSENUM;
+    static constexpr uint16_t one_pulsenum = ONE_PULSENUM;
+    static constexpr uint16_t zero_pulsenum = ZERO_PULSENUM;
+    static constexpr uint16_t pause_pulsenum = PAUSE_PULSENUM;
+};
+
+#endif
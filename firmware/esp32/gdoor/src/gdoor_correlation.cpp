@@ -0,0 +1,277 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "gdoor_correlation.h"
+#include "gdoor_histogram.h"
+#include "gdoor_metrics.h"
+#include "gdoor.h"
+#include "gdoor_utils.h"
+
+namespace GDOOR_CORRELATION {
+    // Request action byte and the action byte of its acknowledgement,
+    // only pairs which are known to be always acknowledged.
+    // Other frames sent by GDOOR_TX complete as soon as they are sent.
+    const uint8_t ack_table[][2] = {
+        { 0x31, 0x0F }, // DOOR_OPEN -> CTRL_DOOROPENER_ACK
+    };
+
+    enum state {
+        FREE,
+        PENDING,
+        ACKED,
+        TIMEOUT,
+        SENT // Sent by GDOOR_TX, no ACK expected
+    };
+
+    struct request {
+        state status;
+        bool tx; // true: sent by GDOOR_TX, false: observed on the bus
+        bool sent; // false: GDOOR_TX is still sending, time not yet known
+        bool expects_ack; // false: completes when sent, ack_action is unused
+        uint8_t action;
+        uint8_t ack_action;
+        uint8_t source[3];
+        uint8_t destination[3];
+        bool has_destination;
+        uint32_t time; // micros() at end of request
+        uint32_t latency; // us between end of request and end of ACK
+    };
+
+    request requests[CORRELATION_PENDING_MAX];
+    GDOOR_HISTOGRAM latency_hist; // request to ACK latency in us
+    uint32_t acked = 0;
+    uint32_t timeouts = 0;
+    uint32_t no_ack_expected = 0; // Sent frames without ACK pair
+
+    /*
+    * Internal function, looks up the expected ACK of a request.
+    * @return ACK action byte, -1 if the action is not acknowledged
+    */
+    int ack_action(uint8_t action) {
+        for (uint8_t i=0; i<sizeof(ack_table)/sizeof(ack_table[0]); i++) {
+            if (ack_table[i][0] == action) {
+                return ack_table[i][1];
+            }
+        }
+        return -1;
+    }
+
+    /*
+    * Internal function, starts tracking a request.
+    * A request which is already pending (e.g. own TX seen on the bus)
+    * is not tracked twice. Observed frames are only tracked if they expect an ACK.
+    * @param data bus data, at least 9 bytes
+    * @param len length of bus data without checksum
+    * @param tx true if the request was sent by GDOOR_TX
+    * @param time end of request (micros), ignored for tx
+    */
+    void add(const uint8_t *data, uint16_t len, bool tx, uint32_t time) {
+        if (len < 9) {
+            return;
+        }
+        int ack = ack_action(data[2]);
+        if (ack < 0 && !tx) {
+            return;
+        }
+
+        int8_t slot = -1;
+        for (uint8_t i=0; i<CORRELATION_PENDING_MAX; i++) {
+            request &req = requests[i];
+            if (req.status == PENDING && req.action == data[2] && memcmp(req.source, &data[3], 3) == 0) {
+                return;
+            }
+            if (slot < 0 && req.status == FREE) {
+                slot = i;
+            }
+        }
+        if (slot < 0) {
+            return; // All slots wait for ACK or report, request is not tracked
+        }
+
+        request &req = requests[slot];
+        req.status = PENDING;
+        req.tx = tx;
+        req.sent = !tx;
+        req.expects_ack = ack >= 0;
+        req.action = data[2];
+        req.ack_action = req.expects_ack ? ack : 0;
+        memcpy(req.source, &data[3], 3);
+        req.has_destination = len >= 12;
+        if (req.has_destination) {
+            memcpy(req.destination, &data[9], 3);
+        }
+        req.time = tx ? micros() : time;
+        req.latency = 0;
+    }
+
+    /*
+    * Internal function, takes over the end time of requests
+    * sent by GDOOR_TX, once sending is done.
+    */
+    void update_sent() {
+        for (uint8_t i=0; i<CORRELATION_PENDING_MAX; i++) {
+            request &req = requests[i];
+            if (req.status == PENDING && !req.sent && !(GDOOR::engine.tx.tx_state & STATE_SENDING)) {
+                req.sent = true;
+                req.time = GDOOR::engine.tx.tx_end_time;
+            }
+        }
+    }
+
+    /*
+    * Called by GDOOR_TX for each frame accepted for sending.
+    * @param data bus data without checksum
+    * @param len length of data
+    */
+    void tx_request(const uint8_t *data, uint16_t len) {
+        add(data, len, true, 0);
+    }
+
+    /*
+    * Called by GDOOR_RX for each parsed frame,
+    * matches ACKs to pending requests and tracks observed requests.
+    * An ACK matches if it is addressed to the requester and,
+    * if the request had a destination, is sent by it.
+    * @param data received bus data, including checksum
+    * @param end_time micros() at end of frame
+    */
+    void rx_frame(GDOOR_DATA *data, uint32_t end_time) {
+        if (!data->valid || data->len < 10) {
+            return;
+        }
+        uint16_t len = data->len - 1; // without checksum
+        const uint8_t *d = data->data;
+        update_sent();
+
+        for (uint8_t i=0; i<CORRELATION_PENDING_MAX; i++) {
+            request &req = requests[i];
+            if (req.status != PENDING || !req.sent || !req.expects_ack || req.ack_action != d[2]) {
+                continue;
+            }
+            if (len >= 12 && memcmp(&d[9], req.source, 3) != 0) {
+                continue;
+            }
+            if (req.has_destination && memcmp(&d[3], req.destination, 3) != 0) {
+                continue;
+            }
+            req.status = ACKED;
+            req.latency = end_time - req.time;
+            latency_hist.add(req.latency);
+            acked++;
+            GDOOR_METRICS::inc(GDOOR_METRICS::REQUESTS_ACKED);
+            return;
+        }
+
+        add(d, len, false, end_time);
+    }
+
+    /*
+    * Needs to be called regularly in main loop(),
+    * handles timeouts and sent frames, checks if a completion record is ready.
+    * @return true if printTo() should be called
+    */
+    bool report_pending() {
+        bool pending = false;
+        uint32_t now = micros();
+        update_sent();
+        for (uint8_t i=0; i<CORRELATION_PENDING_MAX; i++) {
+            request &req = requests[i];
+            if (req.status == PENDING && req.sent && !req.expects_ack) {
+                req.status = SENT;
+                no_ack_expected++;
+            } else if (req.status == PENDING && req.sent && now - req.time > CORRELATION_TIMEOUT_MS*1000UL) {
+                req.status = TIMEOUT;
+                timeouts++;
+                GDOOR_METRICS::inc(GDOOR_METRICS::REQUESTS_TIMEOUT);
+            }
+            pending |= (req.status == ACKED || req.status == TIMEOUT || req.status == SENT);
+        }
+        return pending;
+    }
+
+    /*
+    * Json compatible output of one completion record.
+    * "completion": {"action": "DOOR_OPEN", "source": "A286B1", "destination": "5C8D47", "origin": "tx", "status": "acked", "acked": true, "latency_ms": "120"}
+    * status is acked or timeout for requests which expect an ACK,
+    * no_ack_expected for other frames, as soon as GDOOR_TX sent them.
+    */
+    size_t printTo(Print& p) {
+        size_t r = 0;
+        for (uint8_t i=0; i<CORRELATION_PENDING_MAX; i++) {
+            request &req = requests[i];
+            if (req.status != ACKED && req.status != TIMEOUT && req.status != SENT) {
+                continue;
+            }
+            const char *action = "ACTION_UNKOWN";
+            if (GDOOR_DATA_ACTION.find(req.action) != GDOOR_DATA_ACTION.end()) {
+                action = GDOOR_DATA_ACTION.at(req.action);
+            }
+
+            r+= p.print("\"completion\": {");
+            r+= GDOOR_UTILS::print_json_string(p, "action", action);
+            r+= p.print(", ");
+            r+= GDOOR_UTILS::print_json_hexstring<uint8_t>(p, "source", req.source, 3);
+            r+= p.print(", ");
+            if (req.has_destination) {
+                r+= GDOOR_UTILS::print_json_hexstring<uint8_t>(p, "destination", req.destination, 3);
+                r+= p.print(", ");
+            }
+            r+= GDOOR_UTILS::print_json_string(p, "origin", req.tx ? "tx" : "bus");
+            r+= p.print(", ");
+            r+= GDOOR_UTILS::print_json_string(p, "status", req.status == ACKED ? "acked"
+                                               : req.status == TIMEOUT ? "timeout" : "no_ack_expected");
+            r+= p.print(", ");
+            r+= GDOOR_UTILS::print_json_bool<uint8_t>(p, "acked", req.status == ACKED);
+            if (req.status == ACKED) {
+                r+= p.print(", ");
+                r+= GDOOR_UTILS::print_json_value<uint32_t>(p, "latency_ms", req.latency/1000);
+            }
+            r+= p.print("}");
+
+            req.status = FREE;
+            break;
+        }
+        return r;
+    }
+
+    /*
+    * Json compatible output of ACK counters and request to ACK latency.
+    * "acks": {"acked": "n", "timeouts": "n", "no_ack_expected": "n", "latency_us": {...}}
+    */
+    size_t printStatsTo(Print& p) {
+        size_t r = 0;
+        r+= p.print("\"acks\": {");
+        r+= GDOOR_UTILS::print_json_value<uint32_t>(p, "acked", acked);
+        r+= p.print(", ");
+        r+= GDOOR_UTILS::print_json_value<uint32_t>(p, "timeouts", timeouts);
+        r+= p.print(", ");
+        r+= GDOOR_UTILS::print_json_value<uint32_t>(p, "no_ack_expected", no_ack_expected);
+        r+= p.print(", \"latency_us\": {");
+        r+= p.print(latency_hist);
+        r+= p.print("}}");
+        return r;
+    }
+
+    /*
+    * Reset ACK counters and latency histogram.
+    */
+    void reset() {
+        acked = 0;
+        timeouts = 0;
+        no_ack_expected = 0;
+        latency_hist.reset();
+    }
+}
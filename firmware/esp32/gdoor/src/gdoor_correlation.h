@@ -0,0 +1,34 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GDOOR_CORRELATION_H
+#define GDOOR_CORRELATION_H
+#include <Arduino.h>
+#include "gdoor_data.h"
+
+#define CORRELATION_PENDING_MAX 4 // Requests which wait for their ACK or report at the same time
+#define CORRELATION_TIMEOUT_MS 2000 // Requests without ACK after this time are reported as timeout
+
+namespace GDOOR_CORRELATION { //Namespace as we can only use it once
+    void tx_request(const uint8_t *data, uint16_t len);
+    void rx_frame(GDOOR_DATA *data, uint32_t end_time);
+    bool report_pending();
+    size_t printTo(Print& p);
+    size_t printStatsTo(Print& p);
+    void reset();
+};
+
+#endif
@@ -18,119 +18,20 @@
 #include "defines.h"
 #include "gdoor_data.h"
 #include "gdoor_utils.h"
+#include "gdoor_protocol.h"
+
+#define GDOOR_DATA_MAP_ENTRY(value, name) { value, #name },
 
 // Map the HW Type field between bus value and human readable string
 std::map<int, const char*>GDOOR_DATA_HWTYPE = {
-    { 0xA0, "OUTDOOR"},
-    { 0xA1, "INDOOR"},
-    { 0xA2, "INDOOR_RECEIVER"},
-    { 0xA3, "CONTROLLER"},
-    { 0xA4, "ACTUATOR"},
-    { 0xA5, "GATEWAY_TK"},
-    { 0xA6, "CHIME"},
-    { 0xA7, "BUTTON_IF"},
-    { 0xA8, "GATEWAY_IP"},
+    GDOOR_PROTOCOL_HWTYPES(GDOOR_DATA_MAP_ENTRY)
 };
 
 // Map the Action field between bus value and human readable string
 std::map<int, const char*>GDOOR_DATA_ACTION = {
-    { 0x42, "BUTTON"},
-    { 0x41, "BUTTON_LIGHT"},
-    { 0x31, "DOOR_OPEN"},
-    { 0x28, "VIDEO_REQUEST"},
-    { 0x21, "AUDIO_REQUEST"},
-    { 0x20, "AUDIO_VIDEO_END"},
-    { 0x13, "BUTTON_FLOOR"},
-    { 0x12, "CALL_INTERNAL"},
-    { 0x11, "BUTTON_RING"},
-    { 0x0F, "CTRL_DOOROPENER_ACK"},
-    { 0x08, "CTRL_RESET"},
-    { 0x05, "CTRL_DOORSTATION_ACK"},
-    { 0x04, "CTRL_BUTTONS_TRAINING_START"},
-    { 0x03, "CTRL_DOOROPENER_TRAINING_START"},
-    { 0x02, "CTRL_DOOROPENER_TRAINING_STOP"},
-    { 0x01, "CTRL_PROGRAMMING_START"},
-    { 0x00, "CTRL_PROGRAMMING_STOP"}
+    GDOOR_PROTOCOL_ACTIONS(GDOOR_DATA_MAP_ENTRY)
 };
 
-/**
- * Parse function, reading in the raw timer count values,
- * populating the GDOOR_DATA class elements.
- * 
- * @param counts Array with pulse counts of bits
- * @param len Number of elements in array
- * @return true if parsing was successful
-*/
-bool GDOOR_DATA::parse(uint16_t *counts, uint16_t len) {
-    uint8_t wordcounter = 0; //Current word index
-    uint8_t current_pulsetrain_valid = 1; //If parity or crc fails, this is set to 0
-    uint16_t bit_one_thres = 0; //Dynamic Bit 1/0 threshold, based on length of startpulse
-
-    uint8_t is_startbit = 1; // Flag to indicate current bit is start bit to determine 1/0 threshold based on its width
-    uint8_t bitindex = 0; //Current bit index inside current word, loops from 0 to 8 (9bits per word)
-
-    bool success=false;
-
-    for (uint8_t i=0; i<len; i++) {
-        uint16_t cnt = counts[i];
-        uint8_t bit = 0;
-        this->raw[i] = cnt;
-
-        // Filter out smaller pulses, just ignore them
-        if (cnt < BIT_MIN_LEN) {
-            continue;
-        }
-
-        // Check that first start bit is at least roughly in our expected range
-        if(is_startbit && cnt < STARTBIT_MIN_LEN) {
-            continue;
-        }
-
-        // First bit is start bit and we use it to determine
-        // length of one bit and zero bit
-        if (is_startbit) {
-            bit_one_thres = cnt/BIT_ONE_DIV;
-            is_startbit = 0;
-        } else { //Normal bit
-
-            // We start new receive word so preset the word with value 0
-            if (bitindex == 0) {
-                this->data[wordcounter] = 0;
-            }
-
-            //Detect zero or one bit value
-            if (cnt < bit_one_thres) {
-                bit = 1;
-            }
-
-            // Parity Bit
-            if (bitindex == 8) {
-                // Check if parity bit is as expected
-                if (GDOOR_UTILS::parity_odd(this->data[wordcounter]) != bit) {
-                    current_pulsetrain_valid = 0;
-                }
-                bitindex = 0;
-                wordcounter = wordcounter + 1;
-            } else { // Normal Bits from 0 to 7
-                this->data[wordcounter] |= (uint8_t)(bit << bitindex);
-                bitindex = bitindex + 1;
-            }
-
-        } //End normal bit
-    } //End for  
-    
-    if(wordcounter != 0) {
-        //Check last word for crc value
-        if (GDOOR_UTILS::crc(this->data, wordcounter-1) != this->data[wordcounter-1]) {
-            current_pulsetrain_valid = 0;
-        }
-        this->len = wordcounter;
-        this->valid = current_pulsetrain_valid;
-        success = true;
-    }
-    return success;
-}
-
 /*
 * Constructor for GDOOR_DATA_PROTOCOL,
 * parses the bus data based on GDOOR_DATA,
@@ -181,4 +82,44 @@ GDOOR_DATA_PROTOCOL::GDOOR_DATA_PROTOCOL(GDOOR_DATA* data, bool idle) {
             this->destination[2] = data->data[11];
         }
     }
-}
\ No newline at end of file
+}
+/**
+ * Internal function, reverse lookup of a human readable string
+ * in one of the bus value maps.
+ * @param map GDOOR_DATA_HWTYPE or GDOOR_DATA_ACTION
+ * @param name human readable string, e.g. DOOR_OPEN
+ * @return bus value, -1 if not found
+*/
+static int lookup_value(std::map<int, const char*> &map, const char *name) {
+    for (auto const& entry : map) {
+        if (strcmp(entry.second, name) == 0) {
+            return entry.first;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Encoder, inverse of the GDOOR_DATA_PROTOCOL constructor.
+ * Creates bus data from action, type, parameters, source
+ * and destination. The checksum is not part of the output,
+ * it is added by GDOOR_TX when sending.
+ * 
+ * Byte 0 and 1 default to 0x01 0x10 for frames with one address
+ * and to 0x02 0x00 for frames with source and destination,
+ * callers may overwrite them.
+ * 
+ * @param data Output buffer, at least 12 bytes
+ * @param with_destination true: 12 byte frame with destination, false: 9 byte frame
+ * @return number of bytes, 0 if action or type has no bus value
+*/
+uint16_t GDOOR_DATA_PROTOCOL::encode(uint8_t *data, bool with_destination) const {
+    int action_value = lookup_value(GDOOR_DATA_ACTION, this->action);
+    int type_value = lookup_value(GDOOR_DATA_HWTYPE, this->type);
+    if (action_value < 0 || type_value < 0) {
+        return 0;
+    }
+
+    return GDOOR_PROTOCOL::pack(data, action_value, type_value, this->source, this->parameters,
+                                with_destination ? this->destination : NULL);
+}
@@ -21,18 +21,43 @@
 #include <map>
 #include <Arduino.h>
 #include "defines.h"
+#include "gdoor_config.h"
 #include "gdoor_utils.h"
+#include "gdoor_decoder.h"
 
 extern boolean debug;
+extern std::map<int, const char*>GDOOR_DATA_HWTYPE;
+extern std::map<int, const char*>GDOOR_DATA_ACTION;
 
-class GDOOR_DATA : public Printable { // Class/Struct to collect bus related infos
+class GDOOR_DATA : public GDOOR_FRAME, public Printable { // Class/Struct to collect bus related infos
     public:
-        uint16_t len;
-        uint8_t data[MAX_WORDLEN];
-        uint16_t raw[MAX_WORDLEN*9];
-        uint8_t valid;
+        uint32_t timestamp; // micros() of first edge
 
-        boolean parse(uint16_t *counts, uint16_t len);
+        static size_t print_quality(Print& p, const frame_quality &q) {
+            size_t r = 0;
+
+            // Json compatible output
+            r+= p.print("\"quality\": {");
+            r+= GDOOR_UTILS::print_json_value<uint16_t>(p, "startbit", q.startbit);
+            r+= p.print(", ");
+            r+= GDOOR_UTILS::print_json_value<uint16_t>(p, "threshold", q.threshold);
+            r+= p.print(", ");
+            r+= GDOOR_UTILS::print_json_value<uint16_t>(p, "margin", q.margin);
+            r+= p.print(", ");
+            r+= GDOOR_UTILS::print_json_value<uint16_t>(p, "one_min", q.one_min);
+            r+= p.print(", ");
+            r+= GDOOR_UTILS::print_json_value<uint16_t>(p, "one_max", q.one_max);
+            r+= p.print(", ");
+            r+= GDOOR_UTILS::print_json_value<uint16_t>(p, "zero_min", q.zero_min);
+            r+= p.print(", ");
+            r+= GDOOR_UTILS::print_json_value<uint16_t>(p, "zero_max", q.zero_max);
+            r+= p.print(", ");
+            r+= GDOOR_UTILS::print_json_value<uint8_t>(p, "short_pulses", q.short_pulses);
+            r+= p.print(", ");
+            r+= GDOOR_UTILS::print_json_value<uint16_t>(p, "glitches", q.glitches);
+            r+= p.print("}");
+            return r;
+        }
 
         virtual size_t printTo(Print& p) const {
             size_t r = 0;
@@ -45,6 +70,12 @@ class GDOOR_DATA : public Printable { // Class/Struct to collect bus related inf
             r+= p.print(", ");
 
             r+= GDOOR_UTILS::print_json_bool<uint8_t>(p, "valid", valid);
+            r+= p.print(", ");
+
+            r+= GDOOR_UTILS::print_json_bool<uint8_t>(p, "corrected", corrected);
+            r+= p.print(", ");
+
+            r+= print_quality(p, quality);
 
             return r;
        }
@@ -60,6 +91,7 @@ class GDOOR_DATA_PROTOCOL : public Printable { // Class/Struct to collect bus hi
         uint8_t destination[3];
 
         GDOOR_DATA_PROTOCOL(GDOOR_DATA* data, bool idle = false);
+        uint16_t encode(uint8_t *data, bool with_destination) const;
 
         virtual size_t printTo(Print& p) const {
             size_t r = 0;
@@ -85,6 +117,14 @@ class GDOOR_DATA_PROTOCOL : public Printable { // Class/Struct to collect bus hi
                 r+= GDOOR_UTILS::print_json_hexstring<uint8_t>(p, "busdata", this->raw->data, this->raw->len);
                 r+= p.print(", ");
 
+                r+= GDOOR_DATA::print_quality(p, this->raw->quality);
+                r+= p.print(", ");
+
+                if (this->raw->corrected) {
+                    r+= GDOOR_UTILS::print_json_bool<uint8_t>(p, "corrected", this->raw->corrected);
+                    r+= p.print(", ");
+                }
+
                 if(debug) {
                     r+= GDOOR_UTILS::print_json_hexarray<uint16_t>(p, "raw", this->raw->raw, this->raw->len*9);
                     r+= p.print(", ");
@@ -0,0 +1,217 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GDOOR_DATA_IMPL_H
+#define GDOOR_DATA_IMPL_H
+// Decoder of GDOOR_FRAME, included by gdoor_decoder.h, templates are defined here,
+// so that every engine CONFIG gets its decoder without an explicit instantiation.
+
+/**
+ * Parse function, reading in the raw timer count values,
+ * populating the GDOOR_FRAME class elements.
+ * 
+ * @param counts Array with pulse counts of bits
+ * @param len Number of elements in array
+ * @return true if parsing was successful
+*/
+template<class CONFIG> bool GDOOR_FRAME::parse(const uint16_t *counts, uint16_t len) {
+    uint8_t wordcounter = 0; //Current word index
+    uint8_t current_pulsetrain_valid = 1; //If parity or crc fails, this is set to 0
+    uint32_t parity_failed = 0; //Bit i set if word i has a parity error
+    uint16_t bit_one_thres = 0; //Dynamic Bit 1/0 threshold, based on length of startpulse
+
+    uint8_t is_startbit = 1; // Flag to indicate current bit is start bit to determine 1/0 threshold based on its width
+    uint8_t bitindex = 0; //Current bit index inside current word, loops from 0 to 8 (9bits per word)
+
+    bool success=false;
+
+    frame_quality q = {0, 0, UINT16_MAX, UINT16_MAX, 0, UINT16_MAX, 0, 0, 0};
+
+    for (uint16_t i=0; i<len; i++) {
+        uint16_t cnt = counts[i];
+        uint8_t bit = 0;
+        this->raw[i] = cnt;
+
+        // Filter out smaller pulses, just ignore them
+        if (cnt < CONFIG::bit_min_len) {
+            if (!is_startbit && q.short_pulses < UINT8_MAX) {
+                q.short_pulses++;
+            }
+            continue;
+        }
+
+        // Check that first start bit is at least roughly in our expected range
+        if(is_startbit && cnt < CONFIG::startbit_min_len) {
+            continue;
+        }
+
+        // First bit is start bit and we use it to determine
+        // length of one bit and zero bit
+        if (is_startbit) {
+            bit_one_thres = cnt/CONFIG::bit_one_div;
+            is_startbit = 0;
+            q.startbit = cnt;
+            q.threshold = bit_one_thres;
+        } else { //Normal bit
+
+            // We start new receive word so preset the word with value 0
+            if (bitindex == 0) {
+                this->data[wordcounter] = 0;
+            }
+
+            //Detect zero or one bit value
+            if (cnt < bit_one_thres) {
+                bit = 1;
+                q.one_min = std::min(q.one_min, cnt);
+                q.one_max = std::max(q.one_max, cnt);
+                q.margin = std::min(q.margin, (uint16_t)(bit_one_thres - cnt));
+            } else {
+                q.zero_min = std::min(q.zero_min, cnt);
+                q.zero_max = std::max(q.zero_max, cnt);
+                q.margin = std::min(q.margin, (uint16_t)(cnt - bit_one_thres));
+            }
+
+            // Parity Bit
+            if (bitindex == 8) {
+                // Check if parity bit is as expected
+                if (GDOOR_UTILS::parity_odd(this->data[wordcounter]) != bit) {
+                    current_pulsetrain_valid = 0;
+                    parity_failed |= (uint32_t)1 << wordcounter;
+                }
+                bitindex = 0;
+                wordcounter = wordcounter + 1;
+            } else { // Normal Bits from 0 to 7
+                this->data[wordcounter] |= (uint8_t)(bit << bitindex);
+                bitindex = bitindex + 1;
+            }
+
+        } //End normal bit
+    } //End for  
+    
+    if(wordcounter != 0) {
+        //Check last word for crc value
+        if (GDOOR_UTILS::crc(this->data, wordcounter-1) != this->data[wordcounter-1]) {
+            current_pulsetrain_valid = 0;
+        }
+        this->len = wordcounter;
+        this->raw_len = len;
+        this->valid = current_pulsetrain_valid;
+        this->corrected = 0;
+        this->parity_errors = parity_failed;
+        if (q.one_min == UINT16_MAX) { // No bit of this kind
+            q.one_min = 0;
+        }
+        if (q.zero_min == UINT16_MAX) {
+            q.zero_min = 0;
+        }
+        this->quality = q;
+        success = true;
+    }
+    return success;
+}
+
+/**
+ * Combines two received copies of the same bitstream, e.g. of two RX inputs.
+ * Words with parity error are replaced by the word of the other copy,
+ * if it passed the parity check there. Afterwards the checksum decides.
+ *
+ * @param other Second copy, parsed
+ * @return true if the combined frame is valid
+*/
+inline bool GDOOR_FRAME::combine(const GDOOR_FRAME &other) {
+    if (other.len != this->len || this->len == 0) {
+        return false;
+    }
+    for (uint8_t i=0; i<this->len; i++) {
+        uint32_t word = (uint32_t)1 << i;
+        if ((this->parity_errors & word) && !(other.parity_errors & word)) {
+            this->data[i] = other.data[i];
+            this->parity_errors &= ~word;
+        }
+    }
+    this->valid = this->parity_errors == 0
+                  && GDOOR_UTILS::crc(this->data, this->len-1) == this->data[this->len-1];
+    return this->valid;
+}
+
+/**
+ * Soft-decision correction of a frame with exactly one parity error.
+ * The bit of that word closest to the 1/0 threshold is flipped first,
+ * then the next candidates in order of confidence, until the checksum
+ * matches. At most CONFIG::correct_candidates bits are tried, as every try
+ * is a chance for the checksum to match a wrong frame.
+ *
+ * @return true if the frame was corrected
+*/
+template<class CONFIG> bool GDOOR_FRAME::correct() {
+    if (this->valid || this->len == 0 || this->parity_errors == 0
+        || (this->parity_errors & (this->parity_errors - 1))) { // Not exactly one word
+        return false;
+    }
+    uint8_t word = __builtin_ctz(this->parity_errors);
+
+    // Pulse counts of the 9 bits of this word, skipping pulses as parse() does
+    uint16_t counts[9];
+    uint16_t bitindex = 0;
+    uint8_t is_startbit = 1;
+    for (uint16_t i=0; i<this->raw_len && bitindex < (word+1)*9; i++) {
+        uint16_t cnt = this->raw[i];
+        if (cnt < CONFIG::bit_min_len || (is_startbit && cnt < CONFIG::startbit_min_len)) {
+            continue;
+        }
+        if (is_startbit) {
+            is_startbit = 0;
+            continue;
+        }
+        if (bitindex >= word*9) {
+            counts[bitindex - word*9] = cnt;
+        }
+        bitindex++;
+    }
+    if (bitindex < (word+1)*9) {
+        return false;
+    }
+
+    // Candidates, least confident (smallest margin) first
+    uint8_t order[9];
+    uint16_t margin[9];
+    for (uint8_t b=0; b<9; b++) {
+        margin[b] = std::abs((int32_t)counts[b] - (int32_t)this->quality.threshold);
+        uint8_t j = b;
+        while (j > 0 && margin[order[j-1]] > margin[b]) {
+            order[j] = order[j-1];
+            j--;
+        }
+        order[j] = b;
+    }
+
+    uint8_t original = this->data[word];
+    for (uint8_t c=0; c<CONFIG::correct_candidates && c<9; c++) {
+        uint8_t b = order[c];
+        // Bit 8 is the parity bit itself, data stays as it is
+        this->data[word] = (b < 8) ? (uint8_t)(original ^ (1 << b)) : original;
+        if (GDOOR_UTILS::crc(this->data, this->len-1) == this->data[this->len-1]) {
+            this->parity_errors = 0;
+            this->valid = 1;
+            this->corrected = 1;
+            return true;
+        }
+    }
+    this->data[word] = original;
+    return false;
+}
+
+#endif
@@ -0,0 +1,84 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GDOOR_DECODER_H
+#define GDOOR_DECODER_H
+/*
+* Bitstream decoder of the bus, without Arduino dependencies,
+* so that host software (software/gdoor-capture) decodes like the firmware.
+* GDOOR_DATA adds the output and RX timing on the adapter.
+*/
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include "defines.h"
+#include "gdoor_config.h"
+
+namespace GDOOR_UTILS {
+    /* Checksum of the bus frame, sum of all words */
+    inline uint8_t crc(const uint8_t *words, uint16_t len) {
+        uint8_t crc = 0;
+        for(uint16_t i=0; i<len; i++) {//iterate over all words
+            crc = crc + words[i];
+        }
+        return crc;
+    }
+
+    /* Parity bit of a word, 1 if the number of ones is odd */
+    inline uint8_t parity_odd(uint8_t word) {
+        uint8_t ones = 0;
+
+        while(word != 0) {
+            ones++;
+            word &= (uint8_t)(word-1);
+        }
+
+        /* if ones is odd, least significant bit will be 1 */
+        return ones &0x01;
+    }
+};
+
+struct frame_quality { // Signal quality of a received frame, in RX timer pulses
+    uint16_t startbit; // Length of start bit
+    uint16_t threshold; // 1/0 decision threshold, derived from start bit
+    uint16_t margin; // Smallest distance of any bit to the threshold
+    uint16_t one_min; // Spread of one bits
+    uint16_t one_max;
+    uint16_t zero_min; // Spread of zero bits
+    uint16_t zero_max;
+    uint8_t short_pulses; // Pulses ignored, shorter than BIT_MIN_LEN
+    uint16_t glitches; // Edges rejected by the RX glitch filter, set by GDOOR_RX
+};
+
+class GDOOR_FRAME { // Decoded bus frame and the pulse counts it was decoded from
+    public:
+        uint16_t len;
+        uint8_t data[MAX_WORDLEN];
+        uint16_t raw[MAX_WORDLEN*9];
+        uint16_t raw_len; // Number of pulse counts in raw
+        uint8_t valid;
+        uint8_t corrected; // Made valid by correct()
+        uint32_t parity_errors; // Bit i set: word i failed the parity check
+        frame_quality quality;
+
+        template<class CONFIG = GDOOR_CONFIG> bool parse(const uint16_t *counts, uint16_t len);
+        bool combine(const GDOOR_FRAME &other);
+        template<class CONFIG = GDOOR_CONFIG> bool correct();
+};
+
+#include "gdoor_data_impl.h"
+
+#endif
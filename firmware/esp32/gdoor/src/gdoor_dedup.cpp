@@ -0,0 +1,147 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "gdoor_dedup.h"
+#include "gdoor_utils.h"
+#include "gdoor_metrics.h"
+
+namespace GDOOR_DEDUP {
+    struct entry {
+        uint32_t hash; // GDOOR_UTILS::hash of data/len
+        uint16_t len;
+        uint8_t data[MAX_WORDLEN]; // Frame, compared on hash match and used for the report
+        uint32_t first_seen; // millis() of first copy
+        uint32_t last_seen; // millis() of last copy
+        uint16_t repeats; // Suppressed copies
+        bool used;
+    };
+
+    uint16_t window = 0; // Suppression window (ms) after the last copy, 0: disabled
+    entry cache[DEDUP_CACHE_SIZE];
+    int8_t report = -1; // cache index of an expired entry which needs to be reported
+
+    /*
+    * Setup duplicate suppression.
+    * @param window_ms Identical frames within this time after the last copy are suppressed, 0 disables it.
+    */
+    void setup(uint16_t window_ms) {
+        window = window_ms;
+        memset(cache, 0, sizeof(cache));
+        report = -1;
+    }
+
+    /*
+    * Check if a received frame repeats a frame seen within the window.
+    * Only valid frames are checked, repeats are counted for the first frame.
+    * @param data received bus data
+    * @return true if the frame should be suppressed
+    */
+    bool is_repeat(GDOOR_DATA *data) {
+        if (window == 0 || !data->valid) {
+            return false;
+        }
+        uint32_t now = millis();
+        uint16_t len = min((uint16_t)MAX_WORDLEN, data->len);
+        uint32_t h = GDOOR_UTILS::hash(data->data, data->len);
+        uint8_t oldest = 0;
+
+        for (uint8_t i=0; i<DEDUP_CACHE_SIZE; i++) {
+            entry &e = cache[i];
+            if (e.used && e.hash == h && e.len == data->len && now - e.last_seen <= window
+                && !memcmp(e.data, data->data, len)) { // Hash collisions are no repeats
+                e.last_seen = now;
+                e.repeats++;
+                GDOOR_METRICS::inc(GDOOR_METRICS::RX_DUPLICATES);
+                return true;
+            }
+            if (!e.used || (cache[oldest].used && (int32_t)(e.last_seen - cache[oldest].last_seen) < 0)) {
+                oldest = i;
+            }
+        }
+
+        // New frame, take over the free or oldest slot (not the pending report)
+        if (oldest == report) {
+            return false;
+        }
+        entry &e = cache[oldest];
+        e.used = true;
+        e.hash = h;
+        e.len = data->len;
+        memcpy(e.data, data->data, len);
+        e.first_seen = now;
+        e.last_seen = now;
+        e.repeats = 0;
+        return false;
+    }
+
+    /*
+    * Needs to be called regularly in main loop(),
+    * expires entries and checks if a repeat count is ready to be reported.
+    * @return true if printTo() should be called
+    */
+    bool report_pending() {
+        if (report >= 0) {
+            return true;
+        }
+        uint32_t now = millis();
+        for (uint8_t i=0; i<DEDUP_CACHE_SIZE; i++) {
+            entry &e = cache[i];
+            if (e.used && now - e.last_seen > window) {
+                if (e.repeats > 0) {
+                    report = i;
+                    return true;
+                }
+                e.used = false;
+            }
+        }
+        return false;
+    }
+
+    /*
+    * Json compatible output of the pending repeat report,
+    * which belongs to the first (published) copy of the frame.
+    * "repeat": {"action": "BUTTON_RING", "source": "A286B1", "busdata": "...", "repeats": "3", "duration_ms": "1200"}
+    */
+    size_t printTo(Print& p) {
+        size_t r = 0;
+        if (report < 0) {
+            return r;
+        }
+        entry &e = cache[report];
+        const char *action = "ACTION_UNKOWN";
+        if (e.len > 2 && GDOOR_DATA_ACTION.find(e.data[2]) != GDOOR_DATA_ACTION.end()) {
+            action = GDOOR_DATA_ACTION.at(e.data[2]);
+        }
+
+        r+= p.print("\"repeat\": {");
+        r+= GDOOR_UTILS::print_json_string(p, "action", action);
+        r+= p.print(", ");
+        if (e.len >= 6) {
+            r+= GDOOR_UTILS::print_json_hexstring<uint8_t>(p, "source", &e.data[3], 3);
+            r+= p.print(", ");
+        }
+        r+= GDOOR_UTILS::print_json_hexstring<uint8_t>(p, "busdata", e.data, min((uint16_t)MAX_WORDLEN, e.len));
+        r+= p.print(", ");
+        r+= GDOOR_UTILS::print_json_value<uint16_t>(p, "repeats", e.repeats);
+        r+= p.print(", ");
+        r+= GDOOR_UTILS::print_json_value<uint32_t>(p, "duration_ms", e.last_seen - e.first_seen);
+        r+= p.print("}");
+
+        e.used = false;
+        report = -1;
+        return r;
+    }
+}
@@ -0,0 +1,31 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GDOOR_DEDUP_H
+#define GDOOR_DEDUP_H
+#include <Arduino.h>
+#include "gdoor_data.h"
+
+#define DEDUP_CACHE_SIZE 8 // Number of different frames which are tracked at the same time
+
+namespace GDOOR_DEDUP { //Namespace as we can only use it once
+    void setup(uint16_t window_ms);
+    bool is_repeat(GDOOR_DATA *data);
+    bool report_pending();
+    size_t printTo(Print& p);
+};
+
+#endif
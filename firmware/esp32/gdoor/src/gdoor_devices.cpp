@@ -0,0 +1,220 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <StreamString.h>
+#include "gdoor_devices.h"
+#include "gdoor_utils.h"
+#include "mqtt_helper.h"
+#include "printer_helper.h"
+
+namespace GDOOR_DEVICES {
+    struct device {
+        uint8_t source[3];
+        const char *type; // From GDOOR_DATA_HWTYPE
+        const char *action; // Last action, from GDOOR_DATA_ACTION
+        uint8_t parameters[2]; // Parameters of last action
+        uint8_t destination[3]; // Destination of last action
+        uint32_t last_seen; // millis() of last frame
+        uint32_t count; // Number of frames
+        uint16_t margin_min; // Signal quality of all frames, see frame_quality
+        uint32_t margin_sum;
+        uint16_t startbit_min;
+        uint16_t startbit_max;
+        uint32_t short_pulses;
+        uint32_t glitches;
+        bool announced; // Home Assistant discovery was sent
+    };
+
+    device devices[DEVICES_MAX];
+    uint8_t devices_len = 0;
+
+    const char* prefix = NULL; // e.g. gdoor/device, NULL: do not publish
+    bool ha = false; // Create Home Assistant entities per device
+
+    /*
+    * Internal function, json compatible output of the aggregated signal quality.
+    */
+    size_t print_quality(Print &p, device &d) {
+        size_t r = 0;
+        r+= p.print("\"quality\": {");
+        r+= GDOOR_UTILS::print_json_value<uint16_t>(p, "margin_min", d.margin_min);
+        r+= p.print(", ");
+        r+= GDOOR_UTILS::print_json_value<uint32_t>(p, "margin_avg", d.count ? d.margin_sum/d.count : 0);
+        r+= p.print(", ");
+        r+= GDOOR_UTILS::print_json_value<uint16_t>(p, "startbit_min", d.startbit_min);
+        r+= p.print(", ");
+        r+= GDOOR_UTILS::print_json_value<uint16_t>(p, "startbit_max", d.startbit_max);
+        r+= p.print(", ");
+        r+= GDOOR_UTILS::print_json_value<uint32_t>(p, "short_pulses", d.short_pulses);
+        r+= p.print(", ");
+        r+= GDOOR_UTILS::print_json_value<uint32_t>(p, "glitches", d.glitches);
+        r+= p.print("}");
+        return r;
+    }
+
+    /*
+    * Internal function which publishes the retained state topics of a device,
+    * <prefix>/<source>/last_action and <prefix>/<source>/state.
+    */
+    void publish(device &d) {
+        if (prefix == NULL) {
+            return;
+        }
+        String topic = String(prefix) + "/" + GDOOR_UTILS::hexstring(d.source, 3);
+
+        if (ha && !d.announced) {
+            d.announced = MQTT_HELPER::send_ha_device_discovery(GDOOR_UTILS::hexstring(d.source, 3), d.type, topic);
+        }
+
+        StreamString state;
+        state.print("{");
+        GDOOR_UTILS::print_json_string(state, "type", d.type);
+        state.print(", ");
+        GDOOR_UTILS::print_json_string(state, "action", d.action);
+        state.print(", ");
+        GDOOR_UTILS::print_json_hexstring<uint8_t>(state, "parameters", d.parameters, 2);
+        state.print(", ");
+        GDOOR_UTILS::print_json_hexstring<uint8_t>(state, "destination", d.destination, 3);
+        state.print(", ");
+        GDOOR_UTILS::print_json_value<uint32_t>(state, "count", d.count);
+        state.print(", ");
+        GDOOR_UTILS::print_json_value<uint32_t>(state, "last_seen_s", d.last_seen/1000);
+        state.print(", ");
+        print_quality(state, d);
+        state.print("}");
+
+        MQTT_HELPER::publish(topic + "/last_action", d.action, true);
+        MQTT_HELPER::publish(topic + "/state", state, true);
+    }
+
+    /*
+    * Setup device registry.
+    * @param topic_prefix MQTT topic prefix for the per device topics, NULL to disable publishing
+    * @param ha_entities true: create a Home Assistant entity per device
+    */
+    void setup(const char* topic_prefix, bool ha_entities) {
+        prefix = topic_prefix;
+        ha = ha_entities;
+        devices_len = 0;
+    }
+
+    /*
+    * Register a decoded bus message and publish the state of its source device.
+    * @param busmessage decoded, valid bus message
+    */
+    void update(GDOOR_DATA_PROTOCOL &busmessage) {
+        if (busmessage.raw == NULL || !busmessage.raw->valid || busmessage.raw->len < 9) {
+            return;
+        }
+
+        device *d = NULL;
+        uint8_t oldest = 0;
+        for (uint8_t i=0; i<devices_len; i++) {
+            if (!memcmp(devices[i].source, busmessage.source, 3)) {
+                d = &devices[i];
+                break;
+            }
+            if ((int32_t)(devices[i].last_seen - devices[oldest].last_seen) < 0) {
+                oldest = i;
+            }
+        }
+
+        if (d == NULL) { // New device
+            JSONDEBUG("New device in registry");
+            if (devices_len < DEVICES_MAX) {
+                d = &devices[devices_len++];
+            } else {
+                d = &devices[oldest];
+            }
+            memcpy(d->source, busmessage.source, 3);
+            d->count = 0;
+            d->announced = false;
+            d->margin_min = UINT16_MAX;
+            d->margin_sum = 0;
+            d->startbit_min = UINT16_MAX;
+            d->startbit_max = 0;
+            d->short_pulses = 0;
+            d->glitches = 0;
+        }
+
+        const frame_quality &q = busmessage.raw->quality;
+        d->margin_min = min(d->margin_min, q.margin);
+        d->margin_sum += q.margin;
+        d->startbit_min = min(d->startbit_min, q.startbit);
+        d->startbit_max = max(d->startbit_max, q.startbit);
+        d->short_pulses += q.short_pulses;
+        d->glitches += q.glitches;
+
+        d->type = busmessage.type;
+        d->action = busmessage.action;
+        memcpy(d->parameters, busmessage.parameters, 2);
+        memcpy(d->destination, busmessage.destination, 3);
+        d->last_seen = millis();
+        d->count++;
+
+        publish(*d);
+    }
+
+    /*
+    * Publish the state of all known devices again,
+    * e.g. after a new MQTT connection.
+    */
+    void republish() {
+        for (uint8_t i=0; i<devices_len; i++) {
+            devices[i].announced = false;
+            publish(devices[i]);
+        }
+    }
+
+    /*
+    * Number of devices in the registry.
+    */
+    uint8_t size() {
+        return devices_len;
+    }
+
+    /*
+    * Json compatible output of one device of the registry, one diagnostics
+    * message per device, so the output never exceeds the MQTT buffer:
+    * "device": {"source": "A286B1", "type": "OUTDOOR", "action": "BUTTON_RING", "count": "3", "last_seen_s": "120",
+    *  "quality": {"margin_min": "9", "margin_avg": "11", ...}}, "index": "0", "devices": "5"
+    * @param index 0 .. size()-1
+    */
+    size_t printTo(Print& p, uint8_t index) {
+        size_t r = 0;
+        if (index >= devices_len) {
+            return r;
+        }
+        device &d = devices[index];
+        r+= p.print("\"device\": {");
+        r+= GDOOR_UTILS::print_json_hexstring<uint8_t>(p, "source", d.source, 3);
+        r+= p.print(", ");
+        r+= GDOOR_UTILS::print_json_string(p, "type", d.type);
+        r+= p.print(", ");
+        r+= GDOOR_UTILS::print_json_string(p, "action", d.action);
+        r+= p.print(", ");
+        r+= GDOOR_UTILS::print_json_value<uint32_t>(p, "count", d.count);
+        r+= p.print(", ");
+        r+= GDOOR_UTILS::print_json_value<uint32_t>(p, "last_seen_s", d.last_seen/1000);
+        r+= p.print(", ");
+        r+= print_quality(p, d);
+        r+= p.print("}, ");
+        r+= GDOOR_UTILS::print_json_value<uint8_t>(p, "index", index);
+        r+= p.print(", ");
+        r+= GDOOR_UTILS::print_json_value<uint8_t>(p, "devices", devices_len);
+        return r;
+    }
+}
@@ -0,0 +1,32 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GDOOR_DEVICES_H
+#define GDOOR_DEVICES_H
+#include <Arduino.h>
+#include "gdoor_data.h"
+
+#define DEVICES_MAX 32 // Max. number of devices in the registry, least recently seen is replaced
+
+namespace GDOOR_DEVICES { //Namespace as we can only use it once
+    void setup(const char* topic_prefix, bool ha_entities);
+    void update(GDOOR_DATA_PROTOCOL &busmessage);
+    void republish();
+    uint8_t size();
+    size_t printTo(Print& p, uint8_t index);
+};
+
+#endif
@@ -0,0 +1,175 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "gdoor_filter.h"
+#include "gdoor_metrics.h"
+#include "gdoor_utils.h"
+
+/*
+* Publish filter, decides which received frames are serialized and published.
+* The filter is a space separated list, all given conditions must match:
+*   action=<name>[,<name>...]   e.g. action=BUTTON_RING,DOOR_OPEN
+*   type=<name>[,<name>...]     e.g. type=OUTDOOR
+*   source=<hex>[/<hex mask>]   e.g. source=A286B1 or source=A28600/FFFF00
+*   destination=<hex>[/<hex mask>]
+*   valid=yes|any              any: also publish frames with parity or checksum errors
+* An empty filter publishes all valid frames.
+*/
+namespace GDOOR_FILTER {
+    struct address_filter {
+        uint8_t value[3];
+        uint8_t mask[3]; // All zero: no filter
+    };
+
+    String filter_text;
+    uint32_t actions[8]; // Bit per action byte
+    uint32_t types[8]; // Bit per hardware type byte
+    address_filter source;
+    address_filter destination;
+    bool publish_invalid = false;
+
+    /*
+    * Internal function, sets bits for a comma separated name list.
+    * @return false if a name is unknown
+    */
+    bool parse_names(String names, std::map<int, const char*> &map, uint32_t *table) {
+        memset(table, 0, 8*sizeof(uint32_t));
+        names += ",";
+        int start = 0;
+        int end;
+        while ((end = names.indexOf(',', start)) >= 0) {
+            String name = names.substring(start, end);
+            bool found = false;
+            for (auto const& entry : map) {
+                if (name == entry.second) {
+                    table[entry.first >> 5] |= (1UL << (entry.first & 31));
+                    found = true;
+                }
+            }
+            if (!found) {
+                return false;
+            }
+            start = end + 1;
+        }
+        return true;
+    }
+
+    /*
+    * Internal function, parses <hex>[/<hex mask>].
+    * @return false on parse error
+    */
+    bool parse_address(const String &value, address_filter &filter) {
+        int split = value.indexOf('/');
+        if (split < 0) {
+            memset(filter.mask, 0xFF, 3);
+            return GDOOR_UTILS::parse_hexstring(value, filter.value, 3) == 3;
+        }
+        return GDOOR_UTILS::parse_hexstring(value.substring(0, split), filter.value, 3) == 3
+            && GDOOR_UTILS::parse_hexstring(value.substring(split + 1), filter.mask, 3) == 3;
+    }
+
+    /*
+    * Internal function, compares an address with an address filter.
+    */
+    bool match_address(const uint8_t *address, const address_filter &filter) {
+        for (uint8_t i=0; i<3; i++) {
+            if ((address[i] & filter.mask[i]) != (filter.value[i] & filter.mask[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /*
+    * Compile a filter into the lookup tables.
+    * On error, the filter is cleared and all valid frames are published.
+    * @param filter filter text, see above, NULL or empty for no filter
+    * @return false if the filter could not be parsed
+    */
+    bool setup(const char *filter) {
+        memset(actions, 0xFF, sizeof(actions));
+        memset(types, 0xFF, sizeof(types));
+        memset(&source, 0, sizeof(source));
+        memset(&destination, 0, sizeof(destination));
+        publish_invalid = false;
+        filter_text = filter == NULL ? "" : filter;
+        filter_text.trim();
+
+        String rest = filter_text + " ";
+        int start = 0;
+        int end;
+        bool ok = true;
+        while (ok && (end = rest.indexOf(' ', start)) >= 0) {
+            String token = rest.substring(start, end);
+            start = end + 1;
+            if (token.length() == 0) {
+                continue;
+            } else if (token.startsWith("action=")) {
+                ok = parse_names(token.substring(7), GDOOR_DATA_ACTION, actions);
+            } else if (token.startsWith("type=")) {
+                ok = parse_names(token.substring(5), GDOOR_DATA_HWTYPE, types);
+            } else if (token.startsWith("source=")) {
+                ok = parse_address(token.substring(7), source);
+            } else if (token.startsWith("destination=")) {
+                ok = parse_address(token.substring(12), destination);
+            } else if (token == "valid=any") {
+                publish_invalid = true;
+            } else if (token != "valid=yes") {
+                ok = false;
+            }
+        }
+
+        if (!ok) {
+            setup(NULL);
+        }
+        return ok;
+    }
+
+    /*
+    * Check if a received frame passes the filter,
+    * cheap enough to be called for every frame before serialization.
+    * @param data received bus data, may be NULL
+    * @return true if the frame should be published
+    */
+    bool accept(GDOOR_DATA *data) {
+        if (data == NULL) {
+            return false;
+        }
+        if (!data->valid) {
+            return publish_invalid;
+        }
+        if (data->len < 9) {
+            return true; // Too short to be decoded, published as before
+        }
+        static const uint8_t no_destination[3] = {0x00, 0x00, 0x00}; // As decoded by GDOOR_DATA_PROTOCOL
+        const uint8_t *d = data->data;
+        bool pass = (actions[d[2] >> 5] & (1UL << (d[2] & 31)))
+            && (types[d[8] >> 5] & (1UL << (d[8] & 31)))
+            && match_address(&d[3], source)
+            && match_address(data->len >= 12 ? &d[9] : no_destination, destination);
+        if (!pass) {
+            GDOOR_METRICS::inc(GDOOR_METRICS::RX_FILTERED);
+        }
+        return pass;
+    }
+
+    /*
+    * Returns the active filter text, empty if no filter is set.
+    */
+    const char* get() {
+        return filter_text.c_str();
+    }
+}
@@ -0,0 +1,28 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GDOOR_FILTER_H
+#define GDOOR_FILTER_H
+#include <Arduino.h>
+#include "gdoor_data.h"
+
+namespace GDOOR_FILTER { //Namespace as we can only use it once
+    bool setup(const char *filter);
+    bool accept(GDOOR_DATA *data);
+    const char* get();
+};
+
+#endif
@@ -0,0 +1,61 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GDOOR_FORMATS_H
+#define GDOOR_FORMATS_H
+/*
+* Binary formats of the adapter (UDP stream, framed serial protocol), without Arduino dependencies,
+* so that host software (software/gdoor-client) reads them as the firmware writes them.
+*/
+
+// Binary record of a bus frame (UDP stream, SERIAL_MSG_FRAME), little endian:
+// "GD", version, type, uint32 sequence, uint32 timestamp (us), flags, len, bus data (len bytes)
+#define BINARY_OFFSET_MAGIC 0 // "GD"
+#define BINARY_OFFSET_VERSION 2
+#define BINARY_OFFSET_TYPE 3
+#define BINARY_OFFSET_SEQUENCE 4
+#define BINARY_OFFSET_TIMESTAMP 8
+#define BINARY_OFFSET_FLAGS 12
+#define BINARY_OFFSET_LEN 13
+#define BINARY_HEADER_LEN 14 // Bus data follows the header
+#define BINARY_VERSION 1
+#define BINARY_TYPE_FRAME 0x01 // Received bus frame, data includes checksum
+#define BINARY_TYPE_TX 0x02 // Bus data to send, without checksum
+#define BINARY_FLAG_VALID 0x01
+
+// Framed serial protocol, each message is COBS encoded and terminated by 0x00:
+// type, sequence, payload, CRC-16/CCITT-FALSE of type, sequence and payload (little endian).
+// Adapter messages count the sequence up, host messages use their own sequence,
+// which is returned in the acknowledgement.
+#define SERIAL_OFFSET_TYPE 0
+#define SERIAL_OFFSET_SEQUENCE 1
+#define SERIAL_OFFSET_PAYLOAD 2
+#define SERIAL_FRAMING_LEN 4 // Type, sequence and CRC
+
+#define SERIAL_MSG_FRAME 0x01 // Adapter: received bus frame, binary record
+#define SERIAL_MSG_TX 0x02 // Host: bus data to send, without checksum
+#define SERIAL_MSG_COMMAND 0x03 // Host: text input as in json mode, e.g. *metrics, hex string or json command
+#define SERIAL_MSG_ACK 0x04 // Adapter: type, sequence and SERIAL_ACK_* of a host message
+#define SERIAL_MSG_JSON 0x05 // Adapter: json output without bus data, e.g. diagnostics and BUS_IDLE
+#define SERIAL_MSG_MESSAGE 0x06 // Adapter: text of JSONPRINT
+#define SERIAL_MSG_DEBUG 0x07 // Adapter: text of JSONDEBUG
+#define SERIAL_MSG_CAPTURE 0x08 // Adapter: capture stream (*capture serial), see gdoor_capture.h
+
+#define SERIAL_ACK_OK 0x00
+#define SERIAL_ACK_INVALID 0x01 // Wrong length or empty
+#define SERIAL_ACK_UNSUPPORTED 0x02 // Unknown message type
+
+#endif
@@ -0,0 +1,131 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "gdoor_histogram.h"
+#include "gdoor_utils.h"
+
+/**
+ * Map a value to its bucket index.
+ * Values below 2^HISTOGRAM_SUB_BITS get their own bucket,
+ * above that every power of two is split into 2^HISTOGRAM_SUB_BITS buckets.
+*/
+static inline uint16_t value2bucket(uint32_t value) {
+    const uint32_t sub = 1 << HISTOGRAM_SUB_BITS;
+    if (value < sub) {
+        return value;
+    }
+    uint8_t msb = 31 - __builtin_clz(value);
+    uint16_t index = (msb - HISTOGRAM_SUB_BITS + 1) * sub + ((value >> (msb - HISTOGRAM_SUB_BITS)) & (sub - 1));
+    if (index >= HISTOGRAM_BUCKETS) {
+        index = HISTOGRAM_BUCKETS - 1;
+    }
+    return index;
+}
+
+/**
+ * Largest value which still falls into bucket index.
+*/
+static inline uint32_t bucket2value(uint16_t index) {
+    const uint32_t sub = 1 << HISTOGRAM_SUB_BITS;
+    if (index < sub) {
+        return index;
+    }
+    uint8_t msb = index / sub + HISTOGRAM_SUB_BITS - 1;
+    uint32_t lower = (sub + index % sub) << (msb - HISTOGRAM_SUB_BITS);
+    return lower + (1 << (msb - HISTOGRAM_SUB_BITS)) - 1;
+}
+
+GDOOR_HISTOGRAM::GDOOR_HISTOGRAM() {
+    reset();
+}
+
+/**
+ * Add one sample.
+ * @param value Sample value, e.g. microseconds or cpu cycles
+*/
+void GDOOR_HISTOGRAM::add(uint32_t value) {
+    buckets[value2bucket(value)]++;
+    if (count == 0 || value < min) {
+        min = value;
+    }
+    if (value > max) {
+        max = value;
+    }
+    sum += value;
+    count++;
+}
+
+/**
+ * Clear all samples.
+*/
+void GDOOR_HISTOGRAM::reset() {
+    memset(buckets, 0, sizeof(buckets));
+    count = 0;
+    min = 0;
+    max = 0;
+    sum = 0;
+}
+
+/**
+ * Returns the upper bound of the bucket containing the requested percentile,
+ * clamped to the largest seen value.
+ * @param percent 0 to 100
+*/
+uint32_t GDOOR_HISTOGRAM::percentile(uint8_t percent) const {
+    if (count == 0) {
+        return 0;
+    }
+    uint32_t rank = (uint32_t)(((uint64_t)count * percent + 99) / 100);
+    uint32_t seen = 0;
+    for (uint16_t i=0; i<HISTOGRAM_BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= rank && seen > 0) {
+            uint32_t value = bucket2value(i);
+            return value < max ? value : max;
+        }
+    }
+    return max;
+}
+
+/** Returns the mean value of all samples */
+uint32_t GDOOR_HISTOGRAM::mean() const {
+    if (count == 0) {
+        return 0;
+    }
+    return (uint32_t)(sum / count);
+}
+
+/**
+ * Json compatible output of the summary,
+ * "count": "n", "min": "x", "mean": "x", "p50": "x", "p90": "x", "p99": "x", "max": "x"
+*/
+size_t GDOOR_HISTOGRAM::printTo(Print& p) const {
+    size_t r = 0;
+    r+= GDOOR_UTILS::print_json_value<uint32_t>(p, "count", count);
+    r+= p.print(", ");
+    r+= GDOOR_UTILS::print_json_value<uint32_t>(p, "min", min);
+    r+= p.print(", ");
+    r+= GDOOR_UTILS::print_json_value<uint32_t>(p, "mean", mean());
+    r+= p.print(", ");
+    r+= GDOOR_UTILS::print_json_value<uint32_t>(p, "p50", percentile(50));
+    r+= p.print(", ");
+    r+= GDOOR_UTILS::print_json_value<uint32_t>(p, "p90", percentile(90));
+    r+= p.print(", ");
+    r+= GDOOR_UTILS::print_json_value<uint32_t>(p, "p99", percentile(99));
+    r+= p.print(", ");
+    r+= GDOOR_UTILS::print_json_value<uint32_t>(p, "max", max);
+    return r;
+}
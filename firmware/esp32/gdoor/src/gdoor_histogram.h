@@ -0,0 +1,43 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GDOOR_HISTOGRAM_H
+#define GDOOR_HISTOGRAM_H
+#include <Arduino.h>
+
+// 4 sub-buckets per power of two, last bucket collects everything above ~2^20
+#define HISTOGRAM_SUB_BITS 2
+#define HISTOGRAM_BUCKETS 80
+
+class GDOOR_HISTOGRAM : public Printable { // Log-linear histogram, cheap enough to be updated for every bus frame
+    public:
+        uint32_t buckets[HISTOGRAM_BUCKETS];
+        uint32_t count;
+        uint32_t min;
+        uint32_t max;
+        uint64_t sum;
+
+        GDOOR_HISTOGRAM();
+
+        void add(uint32_t value);
+        void reset();
+        uint32_t percentile(uint8_t percent) const;
+        uint32_t mean() const;
+
+        virtual size_t printTo(Print& p) const;
+};
+
+#endif
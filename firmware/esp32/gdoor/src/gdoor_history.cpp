@@ -0,0 +1,365 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <LittleFS.h>
+#include <StreamString.h>
+#include "gdoor_history.h"
+#include "gdoor_data.h"
+#include "gdoor_utils.h"
+#include "wifi_helper.h"
+
+namespace GDOOR_HISTORY {
+    history_entry ring[HISTORY_SIZE];
+    uint16_t next = 0; // Next ring index to write
+    uint16_t count = 0; // Valid entries in ring
+    uint16_t boot = 0; // Boot counter of this boot
+
+#ifdef GDOOR_HISTORY_LOG
+    uint32_t log_sequence = 0; // Number of last written segment
+    uint16_t log_pending = 0; // Entries not yet written to the log
+#endif
+
+    /*
+    * Internal function, returns unix time or 0 if not synced.
+    */
+    uint32_t now() {
+        time_t t = time(NULL);
+        return t > 1600000000 ? (uint32_t)t : 0;
+    }
+
+    /*
+    * Internal function, returns time since boot in ms,
+    * 64 bit, so unlike millis() it does not wrap after 49 days.
+    */
+    uint64_t uptime_ms() {
+        return esp_timer_get_time()/1000;
+    }
+
+    /*
+    * Internal function, true if entry a was stored before entry b.
+    */
+    bool older(const history_entry &a, const history_entry &b) {
+        return a.boot != b.boot ? (int16_t)(a.boot - b.boot) < 0 : a.uptime_ms < b.uptime_ms;
+    }
+
+    /*
+    * Store a frame, called by GDOOR_RX and GDOOR_TX.
+    * @param data bus data
+    * @param len length of bus data
+    * @param flags HISTORY_FLAG_*
+    */
+    void add(const uint8_t *data, uint16_t len, uint8_t flags) {
+        history_entry &e = ring[next];
+        e.time = now();
+        e.boot = boot;
+        e.uptime_ms = uptime_ms();
+        e.flags = flags;
+        e.len = len;
+        memcpy(e.data, data, min(len, (uint16_t)HISTORY_DATA_LEN));
+        next = (next + 1) % HISTORY_SIZE;
+        if (count < HISTORY_SIZE) {
+            count++;
+        }
+#ifdef GDOOR_HISTORY_LOG
+        if (log_pending < HISTORY_SIZE) {
+            log_pending++;
+        }
+#endif
+    }
+
+    /*
+    * Internal function, checks an entry against a query.
+    */
+    bool match(const history_entry &e, const history_query &q) {
+        if ((q.from > 0 || q.to > 0) && e.time == 0) {
+            return false;
+        }
+        if ((q.from > 0 && e.time < q.from) || (q.to > 0 && e.time > q.to)) {
+            return false;
+        }
+        if (q.last_s > 0) {
+            // Frames of earlier boots only by unix time, uptime of another boot says nothing
+            if (e.boot == boot ? uptime_ms() - e.uptime_ms > q.last_s*1000ULL
+                               : (e.time == 0 || now() == 0 || now() - e.time > q.last_s)) {
+                return false;
+            }
+        }
+        if (q.action >= 0 && (e.len < 3 || e.data[2] != q.action)) {
+            return false;
+        }
+        if (q.has_source && (e.len < 6 || memcmp(&e.data[3], q.source, 3) != 0)) {
+            return false;
+        }
+        return true;
+    }
+
+    /*
+    * Parses a query, key=value pairs separated by space or &, e.g.
+    * "action=DOOR_OPEN source=A286B1 from=1717000000 to=1717003600 last=3600 limit=50 log=1"
+    * @param args query text
+    * @param query returns the parsed query
+    * @return false if a key or value is invalid
+    */
+    bool parse_query(const String &args, history_query &query) {
+        memset(&query, 0, sizeof(query));
+        query.action = -1;
+        query.limit = HISTORY_SIZE;
+
+        String rest = args;
+        rest.replace("&", " ");
+        rest += " ";
+        int start = 0;
+        int end;
+        while ((end = rest.indexOf(' ', start)) >= 0) {
+            String token = rest.substring(start, end);
+            start = end + 1;
+            int split = token.indexOf('=');
+            if (token.length() == 0) {
+                continue;
+            } else if (split < 0) {
+                return false;
+            }
+            String key = token.substring(0, split);
+            String value = token.substring(split + 1);
+            if (key == "from") {
+                query.from = value.toInt();
+            } else if (key == "to") {
+                query.to = value.toInt();
+            } else if (key == "last") {
+                query.last_s = value.toInt();
+            } else if (key == "limit") {
+                query.limit = value.toInt();
+            } else if (key == "log") {
+                query.log = value == "1";
+            } else if (key == "source") {
+                query.has_source = true;
+                if (GDOOR_UTILS::parse_hexstring(value, query.source, 3) != 3) {
+                    return false;
+                }
+            } else if (key == "action") {
+                for (auto const& entry : GDOOR_DATA_ACTION) {
+                    if (value == entry.second) {
+                        query.action = entry.first;
+                    }
+                }
+                if (query.action < 0) {
+                    return false;
+                }
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /*
+    * Internal function, calls visit for every frame matching the query
+    * (without its limit), oldest first.
+    * @return number of matching frames
+    */
+    uint32_t scan(const history_query &query, std::function<void(const history_entry &entry)> visit) {
+        uint32_t results = 0;
+#ifdef GDOOR_HISTORY_LOG
+        // Frames in the log which are not in RAM anymore, frames of this boot
+        // are in RAM if they are not older than the oldest RAM entry
+        if (query.log && LittleFS.begin(true)) {
+            const history_entry &ram_oldest = ring[(next + HISTORY_SIZE - count) % HISTORY_SIZE];
+            uint32_t first = log_sequence >= HISTORY_LOG_SEGMENTS ? log_sequence - HISTORY_LOG_SEGMENTS + 1 : 1;
+            for (uint32_t seq=first; seq<=log_sequence; seq++) {
+                File file = LittleFS.open(String("/history_") + (seq % HISTORY_LOG_SEGMENTS), FILE_READ);
+                uint32_t file_seq = 0;
+                uint16_t entry_size = 0;
+                if (!file || file.read((uint8_t*)&file_seq, sizeof(file_seq)) != sizeof(file_seq) || file_seq != seq
+                    || file.read((uint8_t*)&entry_size, sizeof(entry_size)) != sizeof(entry_size)
+                    || entry_size != sizeof(history_entry)) {
+                    continue;
+                }
+                history_entry e;
+                while (file.read((uint8_t*)&e, sizeof(e)) == sizeof(e)) {
+                    if ((count == 0 || older(e, ram_oldest)) && match(e, query)) {
+                        visit(e);
+                        results++;
+                    }
+                }
+                file.close();
+            }
+            LittleFS.end();
+        }
+#endif
+        uint16_t start = (next + HISTORY_SIZE - count) % HISTORY_SIZE;
+        for (uint16_t i=0; i<count; i++) {
+            const history_entry &e = ring[(start + i) % HISTORY_SIZE];
+            if (match(e, query)) {
+                visit(e);
+                results++;
+            }
+        }
+        return results;
+    }
+
+    /*
+    * Runs a query, oldest frames first. If more frames match than
+    * query.limit, the newest ones are returned, e.g. the latest 20 frames
+    * of the last hour, so matches are counted in a first pass.
+    * Results are handed over one by one, so they can be streamed.
+    * @param query parsed query
+    * @param result called for each matching frame
+    * @return number of results
+    */
+    uint16_t query(const history_query &query, std::function<void(const history_entry &entry)> result) {
+        uint32_t matches = scan(query, [](const history_entry &e) {});
+        uint32_t skip = matches > query.limit ? matches - query.limit : 0;
+        uint16_t results = 0;
+        scan(query, [&](const history_entry &e) {
+            if (skip > 0) {
+                skip--;
+            } else {
+                result(e);
+                results++;
+            }
+        });
+        return results;
+    }
+
+    /*
+    * Json compatible output of one history entry.
+    * {"history": {"time": "1717000000", "boot": "12", "uptime_ms": "1234", "direction": "rx", "valid": true, "action": "DOOR_OPEN", "busdata": "..."}}
+    */
+    size_t printTo(Print& p, const history_entry &e) {
+        size_t r = 0;
+        const char *action = "ACTION_UNKOWN";
+        if (e.len > 2 && GDOOR_DATA_ACTION.find(e.data[2]) != GDOOR_DATA_ACTION.end()) {
+            action = GDOOR_DATA_ACTION.at(e.data[2]);
+        }
+        r+= p.print("\"history\": {");
+        r+= GDOOR_UTILS::print_json_value<uint32_t>(p, "time", e.time);
+        r+= p.print(", ");
+        r+= GDOOR_UTILS::print_json_value<uint16_t>(p, "boot", e.boot);
+        r+= p.print(", ");
+        r+= GDOOR_UTILS::print_json_value<uint64_t>(p, "uptime_ms", e.uptime_ms);
+        r+= p.print(", ");
+        r+= GDOOR_UTILS::print_json_string(p, "direction", (e.flags & HISTORY_FLAG_TX) ? "tx" : "rx");
+        r+= p.print(", ");
+        if (e.flags & HISTORY_FLAG_TX) {
+            r+= GDOOR_UTILS::print_json_bool<uint8_t>(p, "rejected", e.flags & HISTORY_FLAG_REJECTED);
+        } else {
+            r+= GDOOR_UTILS::print_json_bool<uint8_t>(p, "valid", e.flags & HISTORY_FLAG_VALID);
+            if (e.flags & HISTORY_FLAG_CORRECTED) {
+                r+= p.print(", ");
+                r+= GDOOR_UTILS::print_json_bool<uint8_t>(p, "corrected", true);
+            }
+        }
+        r+= p.print(", ");
+        r+= GDOOR_UTILS::print_json_string(p, "action", action);
+        r+= p.print(", ");
+        r+= GDOOR_UTILS::print_json_hexstring<uint8_t>(p, "busdata", e.data, min(e.len, (uint8_t)HISTORY_DATA_LEN));
+        r+= p.print("}");
+        return r;
+    }
+
+    /*
+    * Counts the boot, starts NTP time sync for the timestamps and
+    * registers /history on the web server, e.g. /history?action=DOOR_OPEN&last=3600
+    */
+    void setup() {
+        configTime(0, 0, HISTORY_NTP_SERVER);
+        memset(ring, 0, sizeof(ring));
+
+        if (LittleFS.begin(true)) {
+            File file = LittleFS.open(HISTORY_BOOT_FILE, FILE_READ);
+            if (file && file.read((uint8_t*)&boot, sizeof(boot)) != sizeof(boot)) {
+                boot = 0;
+            }
+            file.close();
+            boot++;
+            file = LittleFS.open(HISTORY_BOOT_FILE, FILE_WRITE, true);
+            if (file) {
+                file.write((const uint8_t*)&boot, sizeof(boot));
+                file.close();
+            }
+            LittleFS.end();
+        }
+
+#ifdef GDOOR_HISTORY_LOG
+        // Continue after the newest segment, each starts with its sequence number
+        if (LittleFS.begin(true)) {
+            for (uint8_t i=0; i<HISTORY_LOG_SEGMENTS; i++) {
+                File file = LittleFS.open(String("/history_") + i, FILE_READ);
+                uint32_t seq = 0;
+                if (file && file.read((uint8_t*)&seq, sizeof(seq)) == sizeof(seq) && seq > log_sequence) {
+                    log_sequence = seq;
+                }
+                file.close();
+            }
+            LittleFS.end();
+        }
+#endif
+
+        WIFI_HELPER::on("/history", [](WebServer &server) {
+            String args;
+            for (int i=0; i<server.args(); i++) {
+                args += server.argName(i) + "=" + server.arg(i) + " ";
+            }
+            history_query q;
+            if (!parse_query(args, q)) {
+                server.send(400, "text/plain", "Invalid query");
+                return;
+            }
+            server.setContentLength(CONTENT_LENGTH_UNKNOWN); // Streamed, chunked response
+            server.send(200, "application/json", "[");
+            bool first = true;
+            query(q, [&server, &first](const history_entry &e) {
+                StreamString s;
+                s.print(first ? "{" : ",\n{");
+                printTo(s, e);
+                s.print("}");
+                server.sendContent(s);
+                first = false;
+            });
+            server.sendContent("]\n");
+            server.sendContent("");
+        });
+    }
+
+    /*
+    * Needs to be called in main loop(),
+    * writes full segments to the LittleFS log (-DGDOOR_HISTORY_LOG).
+    */
+    void loop() {
+#ifdef GDOOR_HISTORY_LOG
+        if (log_pending < HISTORY_LOG_SEGMENT) {
+            return;
+        }
+        if (LittleFS.begin(true)) {
+            log_sequence++;
+            uint8_t segment = log_sequence % HISTORY_LOG_SEGMENTS;
+            uint16_t start = (next + HISTORY_SIZE - log_pending) % HISTORY_SIZE;
+            File file = LittleFS.open(String("/history_") + segment, FILE_WRITE, true);
+            if (file) {
+                uint16_t entry_size = sizeof(history_entry);
+                file.write((const uint8_t*)&log_sequence, sizeof(log_sequence));
+                file.write((const uint8_t*)&entry_size, sizeof(entry_size));
+                for (uint16_t i=0; i<HISTORY_LOG_SEGMENT; i++) {
+                    file.write((const uint8_t*)&ring[(start + i) % HISTORY_SIZE], sizeof(history_entry));
+                }
+                file.close();
+            }
+            LittleFS.end();
+        }
+        log_pending -= HISTORY_LOG_SEGMENT; // Also if write failed, to keep RAM and log in order
+#endif
+    }
+}
@@ -0,0 +1,68 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GDOOR_HISTORY_H
+#define GDOOR_HISTORY_H
+#include <Arduino.h>
+
+#define HISTORY_SIZE 320 // Frames kept in RAM, 30 bytes each
+#define HISTORY_DATA_LEN 14 // Bus data bytes stored per frame, longer frames are cut
+#define HISTORY_MQTT_LIMIT 20 // Max. results per MQTT query, one message each
+#define HISTORY_NTP_SERVER "pool.ntp.org"
+#define HISTORY_BOOT_FILE "/history_boot" // LittleFS file, boot counter
+
+// Optional LittleFS circular log, enabled with -DGDOOR_HISTORY_LOG.
+// Full segments of the RAM ring are written as a whole, one file per segment
+// (uint32 sequence number, uint16 entry size, followed by the entries),
+// segments of another entry layout are skipped.
+#define HISTORY_LOG_SEGMENT 64 // Frames per segment file
+#define HISTORY_LOG_SEGMENTS 16 // Segment files, oldest is overwritten
+
+#define HISTORY_FLAG_VALID 0x01 // Parity and checksum ok
+#define HISTORY_FLAG_TX 0x02 // Sent by GDOOR_TX
+#define HISTORY_FLAG_REJECTED 0x04 // TX was rejected, e.g. bus busy
+#define HISTORY_FLAG_CORRECTED 0x08 // Valid after GDOOR_DATA::correct
+
+struct __attribute__((packed)) history_entry { // Compact frame layout
+    uint32_t time; // Unix time (s), 0 if not synced via NTP
+    uint16_t boot; // Boot counter, frames are ordered by boot and uptime
+    uint64_t uptime_ms; // Since boot, does not wrap like millis()
+    uint8_t flags; // HISTORY_FLAG_*
+    uint8_t len; // Frame length, may be larger than HISTORY_DATA_LEN
+    uint8_t data[HISTORY_DATA_LEN];
+};
+
+struct history_query {
+    uint32_t from; // Unix time (s), 0: no limit
+    uint32_t to; // Unix time (s), 0: no limit
+    uint32_t last_s; // Only frames of the last n seconds, 0: no limit
+    int16_t action; // Action byte, -1: all
+    uint8_t source[3];
+    bool has_source;
+    bool log; // Also search the LittleFS log
+    uint16_t limit; // Max. number of results
+};
+
+namespace GDOOR_HISTORY { //Namespace as we can only use it once
+    void setup();
+    void loop();
+    void add(const uint8_t *data, uint16_t len, uint8_t flags);
+    bool parse_query(const String &args, history_query &query);
+    uint16_t query(const history_query &query, std::function<void(const history_entry &entry)> result);
+    size_t printTo(Print& p, const history_entry &entry);
+};
+
+#endif
@@ -0,0 +1,83 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "gdoor_isrstats.h"
+#include "gdoor_utils.h"
+
+namespace GDOOR_ISRSTATS {
+    stats isr[ISRSTATS_LEN];
+    uint32_t period_start = 0;
+
+    const char* names[ISRSTATS_LEN] = {
+        "isr_extint_rx",
+        "isr_timer_bitstream_received",
+        "isr_timer_60khz",
+        "isr_timer_60khz_period",
+    };
+
+    /*
+    * Clear all measurements.
+    */
+    void reset() {
+        memset(isr, 0, sizeof(isr));
+    }
+
+    /*
+    * Json compatible output of all measurements in cpu cycles,
+    * "isr": {"enabled": true, "cpu_mhz": "240", "isr_extint_rx": {"count": "n", "min": "x", "mean": "x", "max": "x"}, ...}
+    * For isr_timer_60khz_period also the expected value and the jitter (max. deviation from it) is given.
+    */
+    size_t printTo(Print& p) {
+        size_t r = 0;
+        r+= p.print("\"isr\": {");
+#ifdef GDOOR_ISR_PROFILING
+        uint32_t mhz = ESP.getCpuFreqMHz();
+        r+= GDOOR_UTILS::print_json_bool<uint8_t>(p, "enabled", 1);
+        r+= p.print(", ");
+        r+= GDOOR_UTILS::print_json_value<uint32_t>(p, "cpu_mhz", mhz);
+        for (uint8_t i=0; i<ISRSTATS_LEN; i++) {
+            stats s = isr[i]; // Copy, ISRs might update it meanwhile
+            r+= p.print(", \"");
+            r+= p.print(names[i]);
+            r+= p.print("\": {");
+            r+= GDOOR_UTILS::print_json_value<uint32_t>(p, "count", s.count);
+            r+= p.print(", ");
+            r+= GDOOR_UTILS::print_json_value<uint32_t>(p, "min", s.min);
+            r+= p.print(", ");
+            r+= GDOOR_UTILS::print_json_value<uint32_t>(p, "mean", s.count ? (uint32_t)(s.sum/s.count) : 0);
+            r+= p.print(", ");
+            r+= GDOOR_UTILS::print_json_value<uint32_t>(p, "max", s.max);
+            if (i == ISRSTATS_TIMER_60KHZ_PERIOD) {
+                uint32_t expected = mhz*1000000/60000;
+                int32_t jitter = 0;
+                if (s.count) {
+                    jitter = max((int32_t)(s.max - expected), (int32_t)(expected - s.min));
+                    jitter = max(jitter, (int32_t)0);
+                }
+                r+= p.print(", ");
+                r+= GDOOR_UTILS::print_json_value<uint32_t>(p, "expected", expected);
+                r+= p.print(", ");
+                r+= GDOOR_UTILS::print_json_value<float>(p, "jitter_us", (float)jitter/mhz);
+            }
+            r+= p.print("}");
+        }
+#else
+        r+= GDOOR_UTILS::print_json_bool<uint8_t>(p, "enabled", 0);
+#endif
+        r+= p.print("}");
+        return r;
+    }
+}
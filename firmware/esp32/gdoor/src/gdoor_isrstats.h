@@ -0,0 +1,93 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GDOOR_ISRSTATS_H
+#define GDOOR_ISRSTATS_H
+#include <Arduino.h>
+
+// Interrupt service routines which are measured
+#define ISRSTATS_EXTINT_RX 0
+#define ISRSTATS_BITSTREAM_RECEIVED 1
+#define ISRSTATS_TIMER_60KHZ 2
+#define ISRSTATS_TIMER_60KHZ_PERIOD 3 // Cycles between two isr_timer_60khz calls while sending
+#define ISRSTATS_LEN 4
+
+/*
+* ISR execution time instrumentation, only compiled in
+* with build flag -DGDOOR_ISR_PROFILING, otherwise the macros are empty.
+*
+* ISRSTATS_BEGIN() at the beginning of an ISR,
+* ISRSTATS_END(id) before every return of it.
+*/
+#ifdef GDOOR_ISR_PROFILING
+#include <esp_cpu.h>
+#define ISRSTATS_BEGIN() uint32_t isrstats_start = esp_cpu_get_cycle_count()
+#define ISRSTATS_END(id) GDOOR_ISRSTATS::add(id, esp_cpu_get_cycle_count() - isrstats_start)
+#define ISRSTATS_PERIOD(id) GDOOR_ISRSTATS::period(id, isrstats_start)
+#define ISRSTATS_PERIOD_RESET() GDOOR_ISRSTATS::period_start = 0
+#else
+#define ISRSTATS_BEGIN()
+#define ISRSTATS_END(id)
+#define ISRSTATS_PERIOD(id)
+#define ISRSTATS_PERIOD_RESET()
+#endif
+
+namespace GDOOR_ISRSTATS { //Namespace as we can only use it once
+    struct stats {
+        uint32_t count;
+        uint32_t min;
+        uint32_t max;
+        uint64_t sum;
+    };
+
+    extern stats isr[ISRSTATS_LEN];
+    extern uint32_t period_start;
+
+    /*
+    * Add one measurement, inlined so that it lives in the (IRAM) ISR itself.
+    * @param id one of ISRSTATS_*
+    * @param cycles measured cpu cycles
+    */
+    static inline __attribute__((always_inline)) void add(uint8_t id, uint32_t cycles) {
+        stats &s = isr[id];
+        if (s.count == 0 || cycles < s.min) {
+            s.min = cycles;
+        }
+        if (cycles > s.max) {
+            s.max = cycles;
+        }
+        s.sum += cycles;
+        s.count++;
+    }
+
+    /*
+    * Add time since last call as one measurement.
+    * First call after ISRSTATS_PERIOD_RESET() only stores the timestamp.
+    * @param id one of ISRSTATS_*
+    * @param now cycle counter at ISR start
+    */
+    static inline __attribute__((always_inline)) void period(uint8_t id, uint32_t now) {
+        if (period_start != 0) {
+            add(id, now - period_start);
+        }
+        period_start = now;
+    }
+
+    void reset();
+    size_t printTo(Print& p);
+};
+
+#endif
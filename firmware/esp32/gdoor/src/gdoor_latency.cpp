@@ -0,0 +1,167 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "gdoor_latency.h"
+#include "gdoor_utils.h"
+#include "gdoor.h"
+
+namespace GDOOR_LATENCY {
+    uint32_t rx_points[LATENCY_RX_POINTS]; // Timestamps (us) of currently traced RX frame
+    uint8_t rx_marked = 0; // Bitmask of rx_points which are set, 0 if no trace is active
+
+    uint32_t tx_points[LATENCY_TX_POINTS]; // Timestamps (us) of currently traced TX message
+    uint8_t tx_marked = 0; // Bitmask of tx_points which are set, 0 if no trace is active
+
+    // One histogram per stage, a stage is the time between trace point n-1 and n.
+    // Last histogram is the total time from first to last trace point.
+    GDOOR_HISTOGRAM rx_stages[LATENCY_RX_POINTS];
+    GDOOR_HISTOGRAM tx_stages[LATENCY_TX_POINTS];
+
+    const char* rx_stage_names[LATENCY_RX_POINTS] = {"rx_frame", "rx_parse", "rx_decode", "rx_serialize", "rx_publish", "rx_total"};
+    const char* tx_stage_names[LATENCY_TX_POINTS] = {"tx_queue", "tx_start", "tx_total"};
+
+    /*
+    * Internal function which adds the stage durations of a trace to the histograms.
+    * Stages with a missing start or end point are skipped.
+    */
+    void commit(GDOOR_HISTOGRAM *stages, uint32_t *points, uint8_t marked, uint8_t len) {
+        int8_t first = -1;
+        int8_t last = -1;
+        for (uint8_t i=0; i<len; i++) {
+            if (marked & (1 << i)) {
+                if (first < 0) {
+                    first = i;
+                } else if (marked & (1 << (i-1))) {
+                    stages[i-1].add(points[i] - points[i-1]);
+                }
+                last = i;
+            }
+        }
+        if (first == 0 && last == len-1) {
+            stages[len-1].add(points[last] - points[first]);
+        }
+    }
+
+    /*
+    * Start trace of a received bus frame,
+    * called when the bitstream is over.
+    * @param first_edge Timestamp (us) of first RX edge, from ISR
+    * @param end Timestamp (us) of end of frame, from ISR
+    */
+    void rx_begin(uint32_t first_edge, uint32_t end) {
+        rx_points[LATENCY_RX_EDGE] = first_edge;
+        rx_points[LATENCY_RX_END] = end;
+        rx_marked = (1 << LATENCY_RX_EDGE) | (1 << LATENCY_RX_END);
+    }
+
+    /*
+    * Store timestamp of a trace point, ignored if no trace is active.
+    * @param point one of LATENCY_RX_*
+    */
+    void rx_mark(uint8_t point) {
+        if (rx_marked) {
+            rx_points[point] = micros();
+            rx_marked |= (uint8_t)(1 << point);
+        }
+    }
+
+    /*
+    * Stop trace of the current bus frame and add it to the histograms.
+    */
+    void rx_finish() {
+        if (rx_marked) {
+            commit(rx_stages, rx_points, rx_marked, LATENCY_RX_POINTS);
+            rx_marked = 0;
+        }
+    }
+
+    /*
+    * Start trace of a message which should be send out to the bus.
+    * @param received Timestamp (us) when the message was received
+    */
+    void tx_begin(uint32_t received) {
+        tx_points[LATENCY_TX_RECEIVED] = received;
+        tx_marked = (1 << LATENCY_TX_RECEIVED);
+    }
+
+    /*
+    * Store timestamp of a trace point, ignored if no trace is active.
+    * @param point one of LATENCY_TX_*
+    */
+    void tx_mark(uint8_t point) {
+        if (tx_marked) {
+            tx_points[point] = micros();
+            tx_marked |= (uint8_t)(1 << point);
+        }
+    }
+
+    /*
+    * Needs to be called in main loop(),
+    * finishes a TX trace as soon as the ISR reports the first pulse.
+    */
+    void loop() {
+        if (tx_marked) {
+            if (!(tx_marked & (1 << LATENCY_TX_STARTED))) { // Data was not accepted by GDOOR_TX
+                tx_marked = 0;
+            } else if (GDOOR::engine.tx.tx_start_time != 0) {
+                tx_points[LATENCY_TX_PULSE] = GDOOR::engine.tx.tx_start_time;
+                tx_marked |= (1 << LATENCY_TX_PULSE);
+                commit(tx_stages, tx_points, tx_marked, LATENCY_TX_POINTS);
+                tx_marked = 0;
+            }
+        }
+    }
+
+    /*
+    * Clear all histograms.
+    */
+    void reset() {
+        for (uint8_t i=0; i<LATENCY_RX_POINTS; i++) {
+            rx_stages[i].reset();
+        }
+        for (uint8_t i=0; i<LATENCY_TX_POINTS; i++) {
+            tx_stages[i].reset();
+        }
+    }
+
+    /*
+    * Json compatible output of all stage histograms (microseconds),
+    * "latency_us": {"rx_frame": {...}, ..., "tx_total": {...}}
+    */
+    size_t printTo(Print& p) {
+        size_t r = 0;
+        r+= p.print("\"latency_us\": {");
+        for (uint8_t i=0; i<LATENCY_RX_POINTS; i++) {
+            r+= p.print("\"");
+            r+= p.print(rx_stage_names[i]);
+            r+= p.print("\": {");
+            r+= p.print(rx_stages[i]);
+            r+= p.print("}, ");
+        }
+        for (uint8_t i=0; i<LATENCY_TX_POINTS; i++) {
+            r+= p.print("\"");
+            r+= p.print(tx_stage_names[i]);
+            r+= p.print("\": {");
+            r+= p.print(tx_stages[i]);
+            r+= p.print("}");
+            if (i < LATENCY_TX_POINTS-1) {
+                r+= p.print(", ");
+            }
+        }
+        r+= p.print("}");
+        return r;
+    }
+}
@@ -0,0 +1,48 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GDOOR_LATENCY_H
+#define GDOOR_LATENCY_H
+#include <Arduino.h>
+#include "gdoor_histogram.h"
+
+// RX trace points, in the order a bus frame passes them
+#define LATENCY_RX_EDGE 0        // first falling edge (isr_extint_rx)
+#define LATENCY_RX_END 1         // end of frame (isr_timer_bitstream_received)
+#define LATENCY_RX_PARSED 2      // after GDOOR_DATA::parse
+#define LATENCY_RX_DECODED 3     // after GDOOR_DATA_PROTOCOL construction
+#define LATENCY_RX_SERIALIZED 4  // after json serialization
+#define LATENCY_RX_PUBLISHED 5   // after mqttClient.publish returned
+#define LATENCY_RX_POINTS 6
+
+// TX trace points
+#define LATENCY_TX_RECEIVED 0    // MQTT/Serial message received
+#define LATENCY_TX_STARTED 1     // GDOOR_TX accepted data and started the timer
+#define LATENCY_TX_PULSE 2       // first carrier pulse (isr_timer_60khz)
+#define LATENCY_TX_POINTS 3
+
+namespace GDOOR_LATENCY { //Namespace as we can only use it once
+    void rx_begin(uint32_t first_edge, uint32_t end);
+    void rx_mark(uint8_t point);
+    void rx_finish();
+    void tx_begin(uint32_t received);
+    void tx_mark(uint8_t point);
+    void loop();
+    void reset();
+    size_t printTo(Print& p);
+};
+
+#endif
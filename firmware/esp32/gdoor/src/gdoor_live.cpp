@@ -0,0 +1,207 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <lwip/sockets.h>
+#include "gdoor_live.h"
+#include "gdoor_utils.h"
+#include "gdoor_metrics.h"
+#include "wifi_helper.h"
+
+/*
+* Live bus monitor: /live shows the bus messages in the browser,
+* /live/events streams them as Server-Sent Events (/live/events?raw=1 adds the pulse counts).
+* Every browser has its own bounded send queue, which is sent without blocking
+* from loop(), so a slow browser only looses messages and never stalls the bus handling.
+* Dropped messages are counted in GDOOR_METRICS and sent to the browser as "dropped" event.
+*/
+namespace GDOOR_LIVE {
+    LIVE_SINK sink;
+
+    class client : public Print { // Browser connection with its send queue
+        public:
+            WiFiClient connection;
+            bool used = false;
+            bool raw = false; // Send pulse counts too
+            uint8_t queue[LIVE_QUEUE_SIZE];
+            uint16_t head = 0; // Next byte to write
+            uint16_t count = 0; // Bytes in queue
+            uint32_t dropped = 0; // Messages dropped as queue was full
+            uint32_t reported = 0; // Value of dropped last sent to the browser
+
+            uint16_t space() const {
+                return LIVE_QUEUE_SIZE - count;
+            }
+
+            size_t write(uint8_t byte) {
+                if (count >= LIVE_QUEUE_SIZE) {
+                    return 0;
+                }
+                queue[(head + count) % LIVE_QUEUE_SIZE] = byte;
+                count++;
+                return 1;
+            }
+            using Print::write;
+    };
+
+    client clients[LIVE_CLIENTS_MAX];
+    uint32_t last_keepalive = 0;
+
+    const char page[] PROGMEM = R"(<!DOCTYPE html>
+<html><head><meta charset='utf-8'><meta name='viewport' content='width=device-width, initial-scale=1'><title>GDoor Live</title>
+<style>body{font-family:sans-serif}table{border-collapse:collapse;font-size:13px}td,th{border:1px solid #ccc;padding:2px 6px}tr.invalid{color:#a00}</style>
+</head><body><h2>GDoor Live</h2><label><input type='checkbox' id='raw'> pulse counts</label> <span id='state'></span>
+<table><thead><tr><th>#</th><th>time</th><th>action</th><th>source</th><th>destination</th><th>parameters</th><th>type</th><th>busdata</th></tr></thead><tbody id='frames'></tbody></table>
+<script>
+var es;
+function connect(){
+  if(es){es.close();}
+  es=new EventSource('/live/events'+(document.getElementById('raw').checked?'?raw=1':''));
+  es.onopen=function(){document.getElementById('state').textContent='connected';};
+  es.onerror=function(){document.getElementById('state').textContent='disconnected';};
+  es.onmessage=function(e){
+    var m=JSON.parse(e.data); if(!m.action){return;}
+    var r=document.createElement('tr');
+    [m.event_id,new Date().toLocaleTimeString(),m.action,m.source,m.destination,m.parameters,m.type,m.busdata].forEach(function(v){var c=document.createElement('td');c.textContent=v===undefined?'':v;r.appendChild(c);});
+    var t=document.getElementById('frames'); t.insertBefore(r,t.firstChild); if(t.childNodes.length>200){t.removeChild(t.lastChild);}
+  };
+  es.addEventListener('dropped',function(e){document.getElementById('state').textContent='connected, '+JSON.parse(e.data).dropped+' messages dropped';});
+  es.addEventListener('raw',function(e){var t=document.getElementById('frames');if(t.firstChild){t.firstChild.title=JSON.parse(e.data).raw.join(' ');}});
+}
+document.getElementById('raw').onchange=connect; connect();
+</script></body></html>)";
+
+    /*
+    * Internal function, web server handler for /live/events,
+    * takes over the connection of the web server.
+    */
+    void on_events(WebServer &server) {
+        for (uint8_t i=0; i<LIVE_CLIENTS_MAX; i++) {
+            client &c = clients[i];
+            if (!c.used) {
+                c.connection = server.client(); // Keeps the connection open after the handler
+                c.used = true;
+                c.raw = server.arg("raw") == "1";
+                c.head = 0;
+                c.count = 0;
+                c.dropped = 0;
+                c.reported = 0;
+                c.connection.setNoDelay(true);
+                c.print("HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\nConnection: keep-alive\r\n\r\n");
+                c.print("retry: 2000\n\n");
+                return;
+            }
+        }
+        server.send(503, "text/plain", "Too many live clients");
+    }
+
+    /*
+    * Register the /live pages on the web server.
+    */
+    void setup() {
+        WIFI_HELPER::on("/live", [](WebServer &server) {
+            server.send(200, "text/html", page);
+        });
+        WIFI_HELPER::on("/live/events", on_events);
+    }
+
+    /*
+    * Needs to be called in main loop(),
+    * sends queued data without blocking and closes dead connections.
+    */
+    void loop() {
+        bool keepalive = millis() - last_keepalive >= LIVE_KEEPALIVE_MS;
+        if (keepalive) {
+            last_keepalive = millis();
+        }
+        for (uint8_t i=0; i<LIVE_CLIENTS_MAX; i++) {
+            client &c = clients[i];
+            if (!c.used) {
+                continue;
+            }
+            if (keepalive && c.space() > 16) {
+                c.print(": keepalive\n\n");
+            }
+            if (c.dropped != c.reported && c.space() > 48) {
+                c.print("event: dropped\ndata: {");
+                GDOOR_UTILS::print_json_value<uint32_t>(c, "dropped", c.dropped);
+                c.print("}\n\n");
+                c.reported = c.dropped;
+            }
+            while (c.count > 0) {
+                uint16_t len = min((uint16_t)(LIVE_QUEUE_SIZE - c.head), c.count); // Up to end of ring
+                int sent = send(c.connection.fd(), &c.queue[c.head], len, MSG_DONTWAIT);
+                if (sent <= 0) {
+                    if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                        c.connection.stop();
+                        c.used = false;
+                    }
+                    break; // Socket buffer full, retry in next loop
+                }
+                c.head = (c.head + sent) % LIVE_QUEUE_SIZE;
+                c.count -= sent;
+            }
+            if (c.used && !c.connection.connected()) {
+                c.connection.stop();
+                c.used = false;
+            }
+        }
+    }
+}
+
+/** Returns true if at least one browser is connected*/
+bool LIVE_SINK::ready() {
+    for (uint8_t i=0; i<LIVE_CLIENTS_MAX; i++) {
+        if (GDOOR_LIVE::clients[i].used) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Queues json data as event for all browsers,
+ * messages which do not fit into the queue of a browser are dropped.
+ * @param topic unused
+ * @param buffer json data, one line
+ * @param len length of json data
+ * @param data bus data, for the pulse counts
+*/
+void LIVE_SINK::write(const char *topic, const uint8_t *buffer, uint16_t len, GDOOR_DATA *data) {
+    while (len > 0 && (buffer[len-1] == '\n' || buffer[len-1] == '\r')) {
+        len--;
+    }
+    for (uint8_t i=0; i<LIVE_CLIENTS_MAX; i++) {
+        GDOOR_LIVE::client &c = GDOOR_LIVE::clients[i];
+        if (!c.used) {
+            continue;
+        }
+        // Pulse counts: 9 per word, up to 10 characters each
+        uint16_t needed = len + 8 + ((c.raw && data != NULL) ? data->len*9*10 + 32 : 0);
+        if (c.space() < needed) {
+            c.dropped++;
+            GDOOR_METRICS::inc(GDOOR_METRICS::LIVE_DROPPED);
+            continue;
+        }
+        c.print("data: ");
+        c.write(buffer, len);
+        c.print("\n\n");
+        if (c.raw && data != NULL) {
+            c.print("event: raw\ndata: {");
+            GDOOR_UTILS::print_json_hexarray<uint16_t>(c, "raw", data->raw, data->len*9);
+            c.print("}\n\n");
+        }
+    }
+}
@@ -0,0 +1,41 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GDOOR_LIVE_H
+#define GDOOR_LIVE_H
+#include <Arduino.h>
+#include <WiFi.h>
+#include "gdoor_sinks.h"
+
+#define LIVE_CLIENTS_MAX 3 // Browsers connected at the same time
+#define LIVE_QUEUE_SIZE 2048 // Send queue per browser, messages are dropped if it is full
+#define LIVE_KEEPALIVE_MS 15000 // Comment line to detect closed connections
+
+class LIVE_SINK : public GDOOR_SINK { // Json as Server-Sent Events to browsers, see GDOOR_LIVE
+    public:
+        LIVE_SINK() : GDOOR_SINK(SINK_FORMAT_JSON, 0, NULL, false) {}
+        virtual bool ready();
+        virtual void write(const char *topic, const uint8_t *buffer, uint16_t len, GDOOR_DATA *data);
+};
+
+namespace GDOOR_LIVE { //Namespace as we can only use it once
+    extern LIVE_SINK sink;
+
+    void setup();
+    void loop();
+};
+
+#endif
@@ -0,0 +1,141 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <WiFi.h>
+#include "gdoor_metrics.h"
+#include "gdoor_utils.h"
+
+namespace GDOOR_METRICS {
+    uint32_t counters[portNUM_PROCESSORS][COUNTERS];
+
+    const char* names[COUNTERS] = {
+        "gdoor_rx_frames_total",
+        "gdoor_rx_invalid_total",
+        "gdoor_rx_parity_errors_total",
+        "gdoor_rx_checksum_errors_total",
+        "gdoor_rx_bit_overflows_total",
+        "gdoor_rx_duplicates_total",
+        "gdoor_rx_filtered_total",
+        "gdoor_rx_diversity_primary_errors_total",
+        "gdoor_rx_diversity_secondary_errors_total",
+        "gdoor_rx_diversity_combined_total",
+        "gdoor_rx_corrected_total",
+        "gdoor_rx_edges_total",
+        "gdoor_rx_glitch_edges_total",
+        "gdoor_tx_frames_total",
+        "gdoor_tx_rejected_total",
+        "gdoor_requests_acked_total",
+        "gdoor_requests_timeout_total",
+        "gdoor_mqtt_printer_overflows_total",
+        "gdoor_mqtt_reconnects_total",
+        "gdoor_wifi_disconnects_total",
+        "gdoor_serial_errors_total",
+        "gdoor_live_dropped_total",
+    };
+
+    const char* descriptions[COUNTERS] = {
+        "Received bus frames",
+        "Received bus frames with parity or checksum error",
+        "Received bus frames with at least one parity error",
+        "Received bus frames with checksum error",
+        "RX bit buffer overflows",
+        "Suppressed repeated bus frames",
+        "Bus frames not published due to publish filter",
+        "Bus frames with parity or checksum error on the primary RX input",
+        "Bus frames with parity or checksum error on the secondary RX input",
+        "Bus frames only valid by combining both RX inputs",
+        "Received bus frames corrected by flipping their least confident bit",
+        "RX edges counted as carrier pulses",
+        "RX edges rejected as glitch, closer than a carrier period",
+        "Bus frames accepted for sending",
+        "Bus frames rejected for sending",
+        "Bus requests acknowledged",
+        "Bus requests without acknowledgement",
+        "Truncated MQTT/Serial output messages",
+        "MQTT reconnects",
+        "WiFi disconnects",
+        "Serial input messages with framing or CRC error",
+        "Live view messages dropped as the send queue of a browser was full",
+    };
+
+    /*
+    * Sum of a counter over all cores.
+    * @param id Counter to read
+    */
+    uint32_t get(counter id) {
+        uint32_t value = 0;
+        for (uint8_t core=0; core<portNUM_PROCESSORS; core++) {
+            value += __atomic_load_n(&counters[core][id], __ATOMIC_RELAXED);
+        }
+        return value;
+    }
+
+    /*
+    * Json compatible output of all counters,
+    * "metrics": {"gdoor_rx_frames_total": "n", ...}
+    */
+    size_t printTo(Print& p) {
+        size_t r = 0;
+        r+= p.print("\"metrics\": {");
+        for (uint8_t i=0; i<COUNTERS; i++) {
+            r+= GDOOR_UTILS::print_json_value<uint32_t>(p, names[i], get((counter)i));
+            r+= p.print(", ");
+        }
+        r+= GDOOR_UTILS::print_json_value<uint32_t>(p, "gdoor_uptime_seconds", millis()/1000);
+        r+= p.print(", ");
+        r+= GDOOR_UTILS::print_json_value<uint32_t>(p, "gdoor_free_heap_bytes", ESP.getFreeHeap());
+        r+= p.print(", ");
+        r+= GDOOR_UTILS::print_json_value<int32_t>(p, "gdoor_wifi_rssi_dbm", WiFi.RSSI());
+        r+= p.print("}");
+        return r;
+    }
+
+    /*
+    * Internal function which prints one metric in Prometheus text format.
+    */
+    template<typename T> size_t print_prometheus_metric(Print& p, const char* name, const char* type, const char* description, T value) {
+        size_t r = 0;
+        r+= p.print("# HELP ");
+        r+= p.print(name);
+        r+= p.print(" ");
+        r+= p.print(description);
+        r+= p.print("\n"); // Prometheus expects plain \n line endings
+        r+= p.print("# TYPE ");
+        r+= p.print(name);
+        r+= p.print(" ");
+        r+= p.print(type);
+        r+= p.print("\n");
+        r+= p.print(name);
+        r+= p.print(" ");
+        r+= p.print(value);
+        r+= p.print("\n");
+        return r;
+    }
+
+    /*
+    * Output of all counters in Prometheus text exposition format.
+    */
+    size_t printPrometheus(Print& p) {
+        size_t r = 0;
+        for (uint8_t i=0; i<COUNTERS; i++) {
+            r+= print_prometheus_metric<uint32_t>(p, names[i], "counter", descriptions[i], get((counter)i));
+        }
+        r+= print_prometheus_metric<uint32_t>(p, "gdoor_uptime_seconds", "gauge", "Seconds since boot", millis()/1000);
+        r+= print_prometheus_metric<uint32_t>(p, "gdoor_free_heap_bytes", "gauge", "Free heap", ESP.getFreeHeap());
+        r+= print_prometheus_metric<int32_t>(p, "gdoor_wifi_rssi_dbm", "gauge", "WiFi signal strength", WiFi.RSSI());
+        return r;
+    }
+}
@@ -0,0 +1,73 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GDOOR_METRICS_H
+#define GDOOR_METRICS_H
+#include <Arduino.h>
+
+namespace GDOOR_METRICS { //Namespace as we can only use it once
+    enum counter {
+        RX_FRAMES,              // Bitstreams which could be parsed into words
+        RX_INVALID,             // Parsed frames with parity or checksum error
+        RX_PARITY_ERRORS,       // Frames with at least one parity error
+        RX_CHECKSUM_ERRORS,     // Frames with wrong checksum
+        RX_BIT_OVERFLOWS,       // bitcounter wraparounds of the RX bit buffer
+        RX_DUPLICATES,          // Repeated frames suppressed by GDOOR_DEDUP
+        RX_FILTERED,            // Valid frames not published due to GDOOR_FILTER
+        RX_DIVERSITY_PRIMARY_ERRORS,   // Diversity mode: frames the primary input alone got wrong
+        RX_DIVERSITY_SECONDARY_ERRORS, // Diversity mode: frames the secondary input alone got wrong
+        RX_DIVERSITY_COMBINED,  // Diversity mode: frames only valid by combining both inputs
+        RX_CORRECTED,           // Frames made valid by the soft-decision correction
+        RX_EDGES,               // Falling edges counted as carrier pulses
+        RX_GLITCH_EDGES,        // Edges rejected by the RX glitch filter
+        TX_FRAMES,              // Frames accepted for sending
+        TX_REJECTED,            // Frames rejected (TX busy, too long, not parsable)
+        REQUESTS_ACKED,         // Requests acknowledged on the bus, see GDOOR_CORRELATION
+        REQUESTS_TIMEOUT,       // Requests without acknowledgement
+        MQTT_PRINTER_OVERFLOWS, // Messages truncated by MQTT_PRINTER
+        MQTT_RECONNECTS,        // MQTT connections after the first one
+        WIFI_DISCONNECTS,       // WiFi station disconnect events
+        SERIAL_ERRORS,          // Framed serial input with framing or CRC error
+        LIVE_DROPPED,           // Live view messages dropped, send queue of a browser was full
+        COUNTERS
+    };
+
+    // One counter set per core, so that cores never write the same word.
+    extern uint32_t counters[portNUM_PROCESSORS][COUNTERS];
+
+    /*
+    * Increment a counter, lock-free and safe to be called from ISRs.
+    * @param id Counter to increment
+    */
+    static inline __attribute__((always_inline)) void inc(counter id) {
+        __atomic_fetch_add(&counters[xPortGetCoreID()][id], 1, __ATOMIC_RELAXED);
+    }
+
+    /*
+    * Add to a counter, lock-free and safe to be called from ISRs.
+    * @param id Counter to increment
+    * @param n Value to add
+    */
+    static inline __attribute__((always_inline)) void add(counter id, uint32_t n) {
+        __atomic_fetch_add(&counters[xPortGetCoreID()][id], n, __ATOMIC_RELAXED);
+    }
+
+    uint32_t get(counter id);
+    size_t printTo(Print& p);
+    size_t printPrometheus(Print& p);
+};
+
+#endif
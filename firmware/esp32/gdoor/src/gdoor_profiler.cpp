@@ -0,0 +1,137 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "gdoor_profiler.h"
+#include "gdoor_utils.h"
+
+namespace GDOOR_PROFILER {
+    struct section_stats {
+        uint64_t total; // Cycles spent in this section
+        uint32_t max; // Worst case cycles of one loop iteration
+        uint32_t count; // Loop iterations in which the section ran
+    };
+
+    const char* section_names[PROFILE_SECTIONS] = {"wifi", "mqtt", "gdoor", "output", "ingest", "diagnostics", "streams"};
+
+    section_stats sections[PROFILE_SECTIONS];
+    uint64_t loop_total = 0; // Cycles spent in loop()
+    uint32_t loop_max = 0; // Worst case cycles of one loop iteration
+    uint32_t loop_count = 0;
+    uint32_t reset_time = 0; // millis() of last reset
+
+    uint32_t loop_start = 0; // Cycle counter at begin_loop()
+    uint32_t section_start = 0; // Cycle counter at start of current section
+    int8_t current = -1; // Currently running section, -1 if none
+
+    /*
+    * Internal function which adds the running section up to the given cycle count.
+    */
+    inline void close_section(uint32_t now) {
+        if (current >= 0) {
+            uint32_t cycles = now - section_start;
+            section_stats &s = sections[current];
+            s.total += cycles;
+            s.count++;
+            if (cycles > s.max) {
+                s.max = cycles;
+            }
+            current = -1;
+        }
+    }
+
+    /*
+    * Needs to be called at the very beginning of loop().
+    */
+    void begin_loop() {
+        loop_start = ESP.getCycleCount();
+        current = -1;
+    }
+
+    /*
+    * Ends the running section and starts measuring a new one.
+    * @param id one of PROFILE_*
+    */
+    void section(uint8_t id) {
+        uint32_t now = ESP.getCycleCount();
+        close_section(now);
+        current = id;
+        section_start = now;
+    }
+
+    /*
+    * Needs to be called at the very end of loop().
+    */
+    void end_loop() {
+        uint32_t now = ESP.getCycleCount();
+        close_section(now);
+        uint32_t cycles = now - loop_start;
+        loop_total += cycles;
+        loop_count++;
+        if (cycles > loop_max) {
+            loop_max = cycles;
+        }
+    }
+
+    /*
+    * Clear all collected data.
+    */
+    void reset() {
+        memset(sections, 0, sizeof(sections));
+        loop_total = 0;
+        loop_max = 0;
+        loop_count = 0;
+        reset_time = millis();
+    }
+
+    /*
+    * Json compatible output of the profile, times in us,
+    * "profile": {"loops": "n", ..., "sections": {"wifi": {"percent": "x", "mean_us": "x", "max_us": "x"}, ...}}
+    */
+    size_t printTo(Print& p) {
+        uint32_t mhz = ESP.getCpuFreqMHz();
+        uint32_t elapsed = millis() - reset_time;
+        size_t r = 0;
+
+        r+= p.print("\"profile\": {");
+        r+= GDOOR_UTILS::print_json_value<uint32_t>(p, "loops", loop_count);
+        r+= p.print(", ");
+        r+= GDOOR_UTILS::print_json_value<float>(p, "loops_per_second", elapsed ? loop_count*1000.0/elapsed : 0.0);
+        r+= p.print(", ");
+        r+= GDOOR_UTILS::print_json_value<uint32_t>(p, "loop_mean_us", loop_count ? (uint32_t)(loop_total/loop_count/mhz) : 0);
+        r+= p.print(", ");
+        r+= GDOOR_UTILS::print_json_value<uint32_t>(p, "loop_max_us", loop_max/mhz);
+        r+= p.print(", \"sections\": {");
+        for (uint8_t i=0; i<PROFILE_SECTIONS; i++) {
+            section_stats &s = sections[i];
+            r+= p.print("\"");
+            r+= p.print(section_names[i]);
+            r+= p.print("\": {");
+            r+= GDOOR_UTILS::print_json_value<float>(p, "percent", loop_total ? s.total*100.0/loop_total : 0.0);
+            r+= p.print(", ");
+            r+= GDOOR_UTILS::print_json_value<uint32_t>(p, "count", s.count);
+            r+= p.print(", ");
+            r+= GDOOR_UTILS::print_json_value<uint32_t>(p, "mean_us", s.count ? (uint32_t)(s.total/s.count/mhz) : 0);
+            r+= p.print(", ");
+            r+= GDOOR_UTILS::print_json_value<uint32_t>(p, "max_us", s.max/mhz);
+            r+= p.print("}");
+            if (i < PROFILE_SECTIONS-1) {
+                r+= p.print(", ");
+            }
+        }
+        r+= p.print("}}");
+        return r;
+    }
+}
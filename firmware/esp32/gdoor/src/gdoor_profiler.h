@@ -0,0 +1,39 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GDOOR_PROFILER_H
+#define GDOOR_PROFILER_H
+#include <Arduino.h>
+
+// Sections of the main loop()
+#define PROFILE_WIFI 0        // WIFI_HELPER::loop(), config portal
+#define PROFILE_MQTT 1        // MQTT_HELPER::loop(), MQTT client
+#define PROFILE_GDOOR 2       // GDOOR::loop(), decoder
+#define PROFILE_OUTPUT 3      // Protocol decoding, serialization and publishing of bus data
+#define PROFILE_INGEST 4      // Serial/MQTT command ingest and sending
+#define PROFILE_DIAGNOSTICS 5 // Periodic diagnostic messages
+#define PROFILE_STREAMS 6     // GDOOR_LIVE (SSE) and GDOOR_CAPTURE (TCP) clients
+#define PROFILE_SECTIONS 7
+
+namespace GDOOR_PROFILER { //Namespace as we can only use it once
+    void begin_loop();
+    void section(uint8_t id);
+    void end_loop();
+    void reset();
+    size_t printTo(Print& p);
+};
+
+#endif
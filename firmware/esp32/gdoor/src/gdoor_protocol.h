@@ -0,0 +1,91 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GDOOR_PROTOCOL_H
+#define GDOOR_PROTOCOL_H
+/*
+* Bus values of the high level protocol, without Arduino dependencies,
+* so that host software (software/gdoor-client) decodes like the firmware.
+* X(bus value, name), name is used as string and as enum identifier.
+*/
+#include <cstdint>
+#include <cstddef>
+
+// HW Type field (byte 8)
+#define GDOOR_PROTOCOL_HWTYPES(X) \
+    X(0xA0, OUTDOOR) \
+    X(0xA1, INDOOR) \
+    X(0xA2, INDOOR_RECEIVER) \
+    X(0xA3, CONTROLLER) \
+    X(0xA4, ACTUATOR) \
+    X(0xA5, GATEWAY_TK) \
+    X(0xA6, CHIME) \
+    X(0xA7, BUTTON_IF) \
+    X(0xA8, GATEWAY_IP)
+
+// Action field (byte 2)
+#define GDOOR_PROTOCOL_ACTIONS(X) \
+    X(0x42, BUTTON) \
+    X(0x41, BUTTON_LIGHT) \
+    X(0x31, DOOR_OPEN) \
+    X(0x28, VIDEO_REQUEST) \
+    X(0x21, AUDIO_REQUEST) \
+    X(0x20, AUDIO_VIDEO_END) \
+    X(0x13, BUTTON_FLOOR) \
+    X(0x12, CALL_INTERNAL) \
+    X(0x11, BUTTON_RING) \
+    X(0x0F, CTRL_DOOROPENER_ACK) \
+    X(0x08, CTRL_RESET) \
+    X(0x05, CTRL_DOORSTATION_ACK) \
+    X(0x04, CTRL_BUTTONS_TRAINING_START) \
+    X(0x03, CTRL_DOOROPENER_TRAINING_START) \
+    X(0x02, CTRL_DOOROPENER_TRAINING_STOP) \
+    X(0x01, CTRL_PROGRAMMING_START) \
+    X(0x00, CTRL_PROGRAMMING_STOP)
+
+namespace GDOOR_PROTOCOL {
+    /*
+    * Packs the bytes of a bus frame, used by GDOOR_DATA_PROTOCOL::encode
+    * and by the host encoder. The checksum is added when sending.
+    * @param data output buffer, at least 12 bytes
+    * @param source 3 bytes
+    * @param parameters 2 bytes
+    * @param destination 3 bytes, NULL: 9 byte frame without destination
+    * @return number of bytes
+    */
+    inline uint16_t pack(uint8_t *data, uint8_t action, uint8_t type, const uint8_t *source,
+                         const uint8_t *parameters, const uint8_t *destination) {
+        data[0] = destination != NULL ? 0x02 : 0x01;
+        data[1] = destination != NULL ? 0x00 : 0x10;
+        data[2] = action;
+        data[3] = source[0];
+        data[4] = source[1];
+        data[5] = source[2];
+        data[6] = parameters[0];
+        data[7] = parameters[1];
+        data[8] = type;
+
+        if (destination == NULL) {
+            return 9;
+        }
+        data[9] = destination[0];
+        data[10] = destination[1];
+        data[11] = destination[2];
+        return 12;
+    }
+};
+
+#endif
@@ -0,0 +1,432 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <LittleFS.h>
+#include "gdoor_rules.h"
+#include "gdoor.h"
+#include "gdoor_command.h"
+#include "gdoor_utils.h"
+#include "printer_helper.h"
+
+/*
+* Rules are evaluated for each valid received frame, without MQTT,
+* so local automations keep working when WiFi or the broker are down.
+* 
+* Rule format, fields separated by a single space, * matches everything:
+*   <action> <source> <destination> <parameters> tx <command>
+*   <action> <source> <destination> <parameters> tx_delay <ms> <command>
+*   <action> <source> <destination> <parameters> gpio <pin> <ms>
+* <command> is a macro name, structured command or hex string, see GDOOR_COMMAND.
+* Example: BUTTON_RING A286B1 * * gpio 4 500
+*/
+namespace GDOOR_RULES {
+    enum kind {
+        RULE_TX,
+        RULE_GPIO
+    };
+
+    // Bits of rule.match, fields which need to be compared
+    #define MATCH_SOURCE 0x01
+    #define MATCH_DESTINATION 0x02
+    #define MATCH_PARAMETERS 0x04
+
+    struct rule {
+        String text; // Rule as entered, for storage and listing
+        uint8_t match;
+        uint8_t source[3];
+        uint8_t destination[3];
+        uint8_t parameters[2];
+        kind type;
+        uint32_t delay_ms; // TX delay or GPIO pulse length
+        uint8_t pin;
+        uint8_t data[MAX_WORDLEN]; // Pre-encoded TX frame
+        uint16_t len;
+    };
+
+    struct job {
+        bool used;
+        uint32_t due; // millis() when job is executed
+        uint8_t rule;
+    };
+
+    rule rules[RULES_MAX];
+    uint8_t rule_count = 0;
+    uint16_t match_table[256]; // Bitmask of rules per action byte
+    job queue[RULES_QUEUE_MAX];
+
+    /*
+    * Internal function, rebuilds the action byte match table.
+    * Rules with action * are set for all action bytes.
+    * @param index rule index
+    * @param action action byte, -1 for *
+    */
+    void set_match(uint8_t index, int action) {
+        for (uint16_t i=0; i<256; i++) {
+            if (action < 0 || action == i) {
+                match_table[i] |= (1 << index);
+            }
+        }
+    }
+
+    /*
+    * Internal function, parses a hex field or *.
+    * @return true if valid, sets bit in match for non wildcard values
+    */
+    bool parse_field(const String &value, uint8_t *field, uint16_t len, uint8_t bit, uint8_t &match) {
+        if (value == "*") {
+            return true;
+        }
+        match |= bit;
+        return GDOOR_UTILS::parse_hexstring(value, field, len) == len;
+    }
+
+    /*
+    * Internal function, splits the next space separated token off.
+    */
+    String next_token(String &s) {
+        int split = s.indexOf(' ');
+        String token = split < 0 ? s : s.substring(0, split);
+        s = split < 0 ? String("") : s.substring(split + 1);
+        return token;
+    }
+
+    /*
+    * Internal function, true if value is a non empty decimal number.
+    * String::toInt() returns 0 for text, e.g. a rule index "foo".
+    */
+    bool is_number(const String &value) {
+        if (value.length() == 0 || value.length() > 9) {
+            return false;
+        }
+        for (uint16_t i=0; i<value.length(); i++) {
+            if (!isDigit(value[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /*
+    * Internal function, checks if a gpio rule may drive a pin,
+    * prints the allowed pins otherwise.
+    * A wrong pin would be set as output at every boot, e.g. a flash pin crashes the ESP32.
+    */
+    bool gpio_allowed(uint8_t pin) {
+        const uint8_t pins[] = RULES_GPIO_PINS;
+        const uint8_t bus_pins[] = {PIN_TX, PIN_TX_EN, PIN_RX_THRESH,
+                                    RX_PIN_22_NUM, RX_PIN_21_NUM, RX_PIN_12_NUM, RX_PIN_32_NUM};
+        bool allowed = false;
+        for (uint8_t i=0; i<sizeof(pins); i++) {
+            allowed |= pins[i] == pin;
+        }
+        for (uint8_t i=0; i<sizeof(bus_pins); i++) {
+            allowed &= bus_pins[i] != pin;
+        }
+        if (!allowed) {
+            String usable = "";
+            for (uint8_t i=0; i<sizeof(pins); i++) {
+                if (memchr(bus_pins, pins[i], sizeof(bus_pins)) == NULL) {
+                    usable += (usable.length() ? ", " : "") + String(pins[i]);
+                }
+            }
+            JSONPRINT("Rule GPIO " + String(pin) + " is not allowed, usable pins: " + usable);
+        }
+        return allowed;
+    }
+
+    /*
+    * Internal function, compiles a rule into the next free slot.
+    * @param text rule
+    * @param action returns the action byte, -1 for *
+    * @return true if the rule is valid
+    */
+    bool compile(const String &text, int &action) {
+        if (rule_count >= RULES_MAX) {
+            return false;
+        }
+        rule &r = rules[rule_count];
+        String rest = text;
+        rest.trim();
+        r.text = rest;
+        r.match = 0;
+
+        String action_name = next_token(rest);
+        action = -1;
+        if (action_name != "*") {
+            for (auto const& entry : GDOOR_DATA_ACTION) {
+                if (action_name == entry.second) {
+                    action = entry.first;
+                }
+            }
+            if (action < 0) {
+                return false;
+            }
+        }
+        if (!parse_field(next_token(rest), r.source, 3, MATCH_SOURCE, r.match)
+            || !parse_field(next_token(rest), r.destination, 3, MATCH_DESTINATION, r.match)
+            || !parse_field(next_token(rest), r.parameters, 2, MATCH_PARAMETERS, r.match)) {
+            return false;
+        }
+
+        String type = next_token(rest);
+        r.delay_ms = 0;
+        if (type == "tx" || type == "tx_delay") {
+            r.type = RULE_TX;
+            if (type == "tx_delay") {
+                String delay = next_token(rest);
+                if (!is_number(delay)) {
+                    return false;
+                }
+                r.delay_ms = delay.toInt();
+            }
+            int16_t len = GDOOR_COMMAND::encode(rest, r.data, MAX_WORDLEN);
+            if (len <= 0) {
+                return false;
+            }
+            r.len = len;
+        } else if (type == "gpio") {
+            r.type = RULE_GPIO;
+            String pin_text = next_token(rest);
+            if (!is_number(pin_text) || !is_number(rest)) {
+                return false;
+            }
+            long pin = pin_text.toInt();
+            r.delay_ms = rest.toInt();
+            // Only safe output pins, which are not used by GDoor itself
+            if (pin > UINT8_MAX || !gpio_allowed(pin) || r.delay_ms == 0) {
+                return false;
+            }
+            r.pin = pin;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    /*
+    * Internal function, compiles all rules from their text again,
+    * invalid rules are dropped. Pending jobs are dropped, running GPIO
+    * pulses are ended first, pins no rule uses anymore are released.
+    */
+    void rebuild() {
+        String texts[RULES_MAX];
+        uint8_t count = rule_count;
+        bool old_pins[UINT8_MAX + 1] = {false};
+        for (uint8_t i=0; i<count; i++) {
+            texts[i] = rules[i].text; // Rules still hold their compiled pins, remove() only shifts texts
+            if (rules[i].type == RULE_GPIO) {
+                old_pins[rules[i].pin] = true;
+            }
+        }
+        for (uint8_t i=0; i<RULES_QUEUE_MAX; i++) {
+            if (queue[i].used && rules[queue[i].rule].type == RULE_GPIO) {
+                digitalWrite(rules[queue[i].rule].pin, LOW);
+            }
+        }
+        rule_count = 0;
+        memset(match_table, 0, sizeof(match_table));
+        memset(queue, 0, sizeof(queue));
+        for (uint8_t i=0; i<count; i++) {
+            int action;
+            if (compile(texts[i], action)) {
+                set_match(rule_count, action);
+                if (rules[rule_count].type == RULE_GPIO) {
+                    pinMode(rules[rule_count].pin, OUTPUT);
+                    digitalWrite(rules[rule_count].pin, LOW);
+                }
+                rule_count++;
+            } else {
+                JSONDEBUG("Invalid rule");
+            }
+        }
+        for (uint8_t i=0; i<rule_count; i++) {
+            if (rules[i].type == RULE_GPIO) {
+                old_pins[rules[i].pin] = false;
+            }
+        }
+        for (uint16_t pin=0; pin<=UINT8_MAX; pin++) {
+            if (old_pins[pin]) { // Pin of a removed rule
+                digitalWrite(pin, LOW);
+                pinMode(pin, INPUT);
+            }
+        }
+    }
+
+    /*
+    * Internal function, writes all rules to LittleFS.
+    */
+    void save() {
+        if (LittleFS.begin(true)) {
+            File file = LittleFS.open(RULES_FILE, FILE_WRITE, true);
+            if (file) {
+                for (uint8_t i=0; i<rule_count; i++) {
+                    file.println(rules[i].text);
+                }
+                file.close();
+            }
+            LittleFS.end();
+        }
+    }
+
+    /*
+    * Loads and compiles stored rules.
+    * Needs to be called after GDOOR_COMMAND::setup(), rules may use macros.
+    */
+    void setup() {
+        rule_count = 0;
+        if (LittleFS.begin(true)) {
+            File file = LittleFS.open(RULES_FILE, FILE_READ);
+            if (file && !file.isDirectory()) {
+                while (file.available() && rule_count < RULES_MAX) {
+                    String line = file.readStringUntil('\n');
+                    line.trim();
+                    if (line.length() > 0) {
+                        rules[rule_count++].text = line;
+                    }
+                }
+                file.close();
+            }
+            LittleFS.end();
+        }
+        rebuild();
+    }
+
+    /*
+    * Internal function, queues a job of a rule.
+    * For GPIO rules the pin is set immediately, the job resets it.
+    */
+    void schedule(uint8_t index) {
+        rule &r = rules[index];
+        for (uint8_t i=0; i<RULES_QUEUE_MAX; i++) {
+            if (!queue[i].used) {
+                queue[i].used = true;
+                queue[i].due = millis() + r.delay_ms;
+                queue[i].rule = index;
+                if (r.type == RULE_GPIO) {
+                    digitalWrite(r.pin, HIGH);
+                }
+                return;
+            }
+        }
+        JSONDEBUG("Rule queue full");
+    }
+
+    /*
+    * Evaluates all rules for a received frame.
+    * Only rules registered for the action byte are compared.
+    * @param data received bus data
+    */
+    void evaluate(GDOOR_DATA *data) {
+        if (!data->valid || data->len < 9) {
+            return;
+        }
+        const uint8_t *d = data->data;
+        uint16_t candidates = match_table[d[2]];
+        for (uint8_t i=0; candidates != 0; i++, candidates >>= 1) {
+            if (!(candidates & 1)) {
+                continue;
+            }
+            rule &r = rules[i];
+            if ((r.match & MATCH_SOURCE) && memcmp(&d[3], r.source, 3) != 0) {
+                continue;
+            }
+            if ((r.match & MATCH_PARAMETERS) && memcmp(&d[6], r.parameters, 2) != 0) {
+                continue;
+            }
+            if ((r.match & MATCH_DESTINATION) && (data->len < 12 || memcmp(&d[9], r.destination, 3) != 0)) {
+                continue;
+            }
+            schedule(i);
+        }
+    }
+
+    /*
+    * Needs to be called in main loop(),
+    * sends due TX frames once the bus is free and ends GPIO pulses.
+    */
+    void loop() {
+        uint32_t now = millis();
+        for (uint8_t i=0; i<RULES_QUEUE_MAX; i++) {
+            job &j = queue[i];
+            if (!j.used || (int32_t)(now - j.due) < 0) {
+                continue;
+            }
+            rule &r = rules[j.rule];
+            if (r.type == RULE_GPIO) {
+                digitalWrite(r.pin, LOW);
+            } else if (GDOOR::active()) {
+                continue; // Retry in next loop
+            } else {
+                GDOOR::send(r.data, r.len);
+            }
+            j.used = false;
+        }
+    }
+
+    /*
+    * Adds and stores a rule.
+    * @param text rule, see format above
+    * @return false if the rule is invalid or no slot is left
+    */
+    bool add(const String &text) {
+        int action;
+        if (!compile(text, action)) {
+            return false;
+        }
+        rule_count++;
+        rebuild();
+        save();
+        return true;
+    }
+
+    /*
+    * Removes a stored rule.
+    * @param index_text rule index, as listed by printTo
+    * @return false if index is invalid
+    */
+    bool remove(const String &index_text) {
+        if (!is_number(index_text) || index_text.toInt() >= rule_count) {
+            return false;
+        }
+        uint8_t index = index_text.toInt();
+        for (uint8_t i=index; i+1<rule_count; i++) {
+            rules[i].text = rules[i+1].text;
+        }
+        rule_count--;
+        rebuild();
+        save();
+        return true;
+    }
+
+    /*
+    * Json compatible output of all rules.
+    * "rules": {"0": "BUTTON_RING A286B1 * * gpio 4 500", ...}
+    */
+    size_t printTo(Print& p) {
+        size_t r = 0;
+        r+= p.print("\"rules\": {");
+        for (uint8_t i=0; i<rule_count; i++) {
+            if (i > 0) {
+                r+= p.print(", ");
+            }
+            String text = rules[i].text;
+            text.replace("\"", "\\\""); // Structured commands contain quotes
+            r+= GDOOR_UTILS::print_json_string(p, String(i).c_str(), text.c_str());
+        }
+        r+= p.print("}");
+        return r;
+    }
+}
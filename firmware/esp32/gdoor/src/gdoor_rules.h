@@ -0,0 +1,38 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GDOOR_RULES_H
+#define GDOOR_RULES_H
+#include <Arduino.h>
+#include "gdoor_data.h"
+
+#define RULES_MAX 16 // Number of rules, one bit per rule in the match table
+#define RULES_QUEUE_MAX 8 // Delayed TX frames and GPIO pulses waiting at the same time
+#define RULES_FILE "/rules" // LittleFS file, one rule per line
+// Output pins a gpio rule may drive, bus pins are excluded additionally.
+// Not listed: 0 (boot mode), 1/3 (UART0), 6-11 (flash), 34-39 (input only)
+#define RULES_GPIO_PINS {2, 4, 5, 12, 13, 14, 15, 16, 17, 18, 19, 23, 25, 26, 27, 32, 33}
+
+namespace GDOOR_RULES { //Namespace as we can only use it once
+    void setup();
+    void loop();
+    void evaluate(GDOOR_DATA *data);
+    bool add(const String &rule);
+    bool remove(const String &index);
+    size_t printTo(Print& p);
+};
+
+#endif
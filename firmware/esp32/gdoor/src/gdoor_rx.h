@@ -19,15 +19,376 @@
 
 #define GDOOR_RX_H
 #include <Arduino.h>
+#include <esp_cpu.h>
+#include "defines.h"
+#include "gdoor_config.h"
 #include "gdoor_data.h"
+#include "gdoor_utils.h"
+#include "printer_helper.h"
+#include "gdoor_latency.h"
+#include "gdoor_metrics.h"
+#include "gdoor_busstats.h"
+#include "gdoor_correlation.h"
+#include "gdoor_history.h"
+#include "gdoor_capture.h"
+#include "gdoor_isrstats.h"
+#include "gdoor_threshold.h"
 
-namespace GDOOR_RX { //Namespace as we can only use it once
-    extern uint16_t rx_state;
-    void setup(uint8_t rxpin);
-    void loop();
-    void enable();
-    void disable();
-    GDOOR_DATA* read();
+/*
+* Receiver of one bus interface.
+* @param CONFIG timings and buffer sizes, see gdoor_config.h
+* @param INSTANCE number of the bus interface, one object per INSTANCE.
+*        Instance 0 is the adapter's bus, it feeds the diagnostics
+*        (metrics, ISR profiling, latency, capture, bus statistics, history,
+*        threshold calibration).
+*/
+template<class CONFIG, uint8_t INSTANCE>
+class GDOOR_RX {
+    static_assert(CONFIG::max_wordlen <= MAX_WORDLEN, "GDOOR_DATA holds at most MAX_WORDLEN words");
+
+    public:
+        static constexpr bool primary = (INSTANCE == 0);
+
+        uint16_t rx_state = 0; // State Machine
+        volatile uint32_t rx_start_time = 0; // Timestamp (us) of first edge of current bitstream
+        volatile uint32_t rx_end_time = 0; // Timestamp (us) when bitstream was detected as over
+
+        /*
+        * Function called by user to setup everything needed for GDoor.
+        * @param int rxpin Pin number where pulses from bus are received
+        * @param int rxpin_secondary Second input for diversity reception, RX_PIN_NONE: single input
+        */
+        void setup(uint8_t rxpin, uint8_t rxpin_secondary = RX_PIN_NONE) {
+            self = this;
+            channel_count = (rxpin_secondary == RX_PIN_NONE) ? 1 : 2;
+            channels[0].pin = rxpin;
+            channels[1].pin = rxpin_secondary;
+
+            uint32_t mhz = ESP.getCpuFreqMHz();
+            edge_min_cycles = CONFIG::rx_edge_min_spacing_us * mhz;
+            bit_timeout_cycles = (uint64_t)CONFIG::rx_bit_timeout * mhz * 1000000 / CONFIG::rx_timer_freq;
+            reset();
+
+            retval.len = 0;
+            retval.valid = 0;
+
+            for (uint8_t i=0; i<channel_count; i++) {
+                pinMode(channels[i].pin, INPUT);
+            }
+
+            // Set bitstream_received timer frequency to 120kHz
+            timer_bitstream_received = timerBegin(CONFIG::rx_timer_freq);
+
+            // Attach isr_timer_bitstream_received function to bitstream_received timer.
+            timerAttachInterrupt(timer_bitstream_received, &isr_timer_bitstream_received);
+
+            // Set alarm to call isr_timer_bitstream_received function
+            // after 6*STARTBIT_MIN_LEN 120kHz Cycles (= 3 * STARTBIT_MIN_LEN 60kHz Cycles)
+            timerAlarm(timer_bitstream_received, CONFIG::rx_bitstream_timeout, true, 0);
+
+            // Enable External RX Interrupt
+            enable();
+
+            // Set Timer to default values, just to be sure
+            timerWrite(timer_bitstream_received, 0); //reset timer
+            timerStop(timer_bitstream_received);
+        }
+
+        /*
+        * Function to enable/disable RX, so that during TX we can disable RX to not get our own message
+        */
+        void enable() {
+            reset();
+            attachInterrupt(channels[0].pin, isr_extint_rx<0>, FALLING);
+            if (channel_count > 1) {
+                attachInterrupt(channels[1].pin, isr_extint_rx<1>, FALLING);
+            }
+        }
+
+        /*
+        * Function to enable/disable RX, so that during TX we can disable RX to not get our own message
+        */
+        void disable() {
+            reset();
+            for (uint8_t i=0; i<channel_count; i++) {
+                detachInterrupt(channels[i].pin);
+            }
+        }
+
+        /*
+        * Enable/disable the soft-decision correction of frames
+        * with a single parity error, see GDOOR_DATA::correct.
+        */
+        void set_correction(bool enabled) {
+            correction = enabled;
+        }
+
+        /*
+        * Function called by user, in main loop.
+        * Needed for the decoding logic.
+        */
+        void loop() {
+            if (rx_state & FLAG_BITSTREAM_RECEIVED) {
+                rx_state &= (uint16_t)~FLAG_BITSTREAM_RECEIVED;
+                JSONDEBUG("Gira RX done");
+                if constexpr (primary) {
+                    GDOOR_LATENCY::rx_begin(rx_start_time, rx_end_time);
+                    GDOOR_BUSSTATS::rx_burst(rx_start_time, rx_end_time);
+                }
+                retval.timestamp = rx_start_time;
+                bool parsed = retval.parse<CONFIG>(channels[0].counts, channels[0].bitcounter);
+                count_edges(channels[0], &retval);
+                if constexpr (primary) {
+                    GDOOR_CAPTURE::record(channels[0].counts, channels[0].bitcounter, rx_start_time,
+                                          parsed ? (CAPTURE_FLAG_PARSED | (retval.valid ? CAPTURE_FLAG_VALID : 0)) : 0);
+                }
+                if (channel_count > 1) {
+                    parsed = select_diversity(parsed);
+                }
+                if (parsed) {
+                    JSONDEBUG("Gira RX was successfully parsed");
+                    count_frame(&retval);
+                    if (correction && retval.correct<CONFIG>()) {
+                        JSONDEBUG("Gira RX was corrected");
+                        if constexpr (primary) {
+                            GDOOR_METRICS::inc(GDOOR_METRICS::RX_CORRECTED);
+                        }
+                    }
+                    if constexpr (primary) {
+                        GDOOR_LATENCY::rx_mark(LATENCY_RX_PARSED);
+                        GDOOR_BUSSTATS::rx_frame(&retval);
+                        GDOOR_CORRELATION::rx_frame(&retval, rx_end_time);
+                        GDOOR_HISTORY::add(retval.data, retval.len, (retval.valid ? HISTORY_FLAG_VALID : 0)
+                                           | (retval.corrected ? HISTORY_FLAG_CORRECTED : 0));
+                    }
+                    rx_state |= FLAG_DATA_READY;
+                } else if constexpr (primary) {
+                    GDOOR_LATENCY::rx_finish();
+                }
+                reset();
+            }
+        }
+
+        /**
+        * User function, called to see if new data is available.
+        * @return Data pointer as GDOOR_RX_DATA class or NULL if no data is available
+        */
+        GDOOR_DATA* read() {
+            if(rx_state & FLAG_DATA_READY) {
+                rx_state &= (uint16_t)~FLAG_DATA_READY;
+                return &retval;
+            }
+            return NULL;
+        }
+
+    private:
+        struct rx_channel { // Capture state of one RX input
+            uint8_t pin;
+            uint16_t counts[CONFIG::max_wordlen*9]; // Received counter values of bitstream, buffer
+            uint16_t isr_cnt; // Interrupt Counter (Counting RX edges)
+            uint8_t bitcounter; //Current bit index, in currently active bitstream
+            uint32_t last_edge; // CPU cycle count of last accepted edge
+            uint16_t glitches; // Edges rejected in current bitstream
+        };
+
+        // Primary input and, in diversity mode, the secondary input.
+        // Both share the bitstream timer, bits end by the gap to the next edge,
+        // so an instance needs only one of the 4 hardware timers.
+        rx_channel channels[RX_CHANNELS_MAX];
+        uint8_t channel_count = 1;
+
+        GDOOR_DATA retval;
+        GDOOR_DATA retval_secondary; // Diversity mode only
+
+        bool correction = false; // Soft-decision correction of single parity errors
+
+        hw_timer_t * timer_bitstream_received = NULL;
+        uint32_t edge_min_cycles = 0; // CONFIG::rx_edge_min_spacing_us in CPU cycles
+        uint32_t bit_timeout_cycles = 0; // CONFIG::rx_bit_timeout in CPU cycles
+
+        static GDOOR_RX *self; // Object of this INSTANCE, used by the ISRs
+
+        /*
+        * ISR trampolines, generated per INSTANCE and input,
+        * so that the ISRs need neither an argument nor a lookup.
+        * ISR profiling measures instance 0 only.
+        */
+        template<uint8_t CHANNEL> static void ARDUINO_ISR_ATTR isr_extint_rx() {
+            if constexpr (primary) {
+                ISRSTATS_BEGIN();
+                self->edge(self->channels[CHANNEL]);
+                ISRSTATS_END(ISRSTATS_EXTINT_RX);
+            } else {
+                self->edge(self->channels[CHANNEL]);
+            }
+        }
+
+        static void ARDUINO_ISR_ATTR isr_timer_bitstream_received() {
+            if constexpr (primary) {
+                ISRSTATS_BEGIN();
+                self->bitstream_received();
+                ISRSTATS_END(ISRSTATS_BITSTREAM_RECEIVED);
+            } else {
+                self->bitstream_received();
+            }
+        }
+
+        /*
+        * We received a 60kHz pulse, so restart the timeout timer of the bitstream and increment bit pulse count,
+        * so that logic knows how much pulses were in this bit pulse-train.
+        * A gap longer than CONFIG::rx_bit_timeout ends the pulse-train of the previous bit.
+        * Edges closer to the previous one than a carrier period allows are noise spikes,
+        * they are only counted as glitch.
+        * @param channel RX input of the edge
+        */
+        inline __attribute__((always_inline)) void edge(rx_channel &channel) {
+            uint32_t now = esp_cpu_get_cycle_count();
+            uint32_t spacing = now - channel.last_edge;
+            if (spacing < edge_min_cycles) {
+                channel.glitches = channel.glitches + 1;
+                return;
+            }
+            channel.last_edge = now;
+            if (!(rx_state & FLAG_RX_ACTIVE)) { // First edge of a new bitstream
+                rx_start_time = micros();
+            }
+            rx_state |= (uint16_t)FLAG_RX_ACTIVE;
+            if (spacing > bit_timeout_cycles && channel.isr_cnt > 0) {
+                bit_received(channel);
+            }
+            channel.isr_cnt = channel.isr_cnt + 1;
+            timerWrite(timer_bitstream_received, 0); //reset timer
+            timerStart(timer_bitstream_received); //Start timer to detect bistream is over
+        }
+
+        /*
+        * The rx 60kHz pulse-train stopped,
+        * so we should store how many pulses we got for this bit (to decide 1 or 0)
+        * @param channel RX input of the bit
+        */
+        inline __attribute__((always_inline)) void bit_received(rx_channel &channel) {
+            if (channel.bitcounter >= CONFIG::max_wordlen*9) {
+                channel.bitcounter = 0;
+                if constexpr (primary) {
+                    GDOOR_METRICS::inc(GDOOR_METRICS::RX_BIT_OVERFLOWS);
+                }
+            }
+            channel.counts[channel.bitcounter] = channel.isr_cnt;
+            channel.isr_cnt = 0;
+            channel.bitcounter = channel.bitcounter + 1;
+        }
+
+        /*
+        * If the bitstream timer fires, rx bit stream is over
+        */
+        inline __attribute__((always_inline)) void bitstream_received() {
+            rx_state &= (uint16_t)~FLAG_RX_ACTIVE;
+            rx_state |= (uint16_t)FLAG_BITSTREAM_RECEIVED;
+            rx_end_time = micros();
+            timerStop(timer_bitstream_received);
+            for (uint8_t i=0; i<channel_count; i++) {
+                if (channels[i].isr_cnt > 0) { // Last bit
+                    bit_received(channels[i]);
+                }
+            }
+        }
+
+        /*
+        * Internal function set reset all internal values.
+        */
+        void reset() {
+            for (uint8_t i=0; i<channel_count; i++) {
+                channels[i].bitcounter = 0;
+                channels[i].isr_cnt = 0;
+                channels[i].glitches = 0;
+            }
+        }
+
+        /*
+        * Internal function, counts the edges of a bitstream in the RX metrics (instance 0),
+        * and stores the glitches in the signal quality of its frame.
+        * @param channel input of the bitstream
+        * @param data frame parsed from this input
+        */
+        void count_edges(rx_channel &channel, GDOOR_DATA *data) {
+            uint32_t edges = 0;
+            for (uint8_t i=0; i<channel.bitcounter; i++) {
+                edges += channel.counts[i];
+            }
+            if constexpr (primary) {
+                GDOOR_METRICS::add(GDOOR_METRICS::RX_EDGES, edges);
+                GDOOR_METRICS::add(GDOOR_METRICS::RX_GLITCH_EDGES, channel.glitches);
+            }
+            data->quality.glitches = channel.glitches;
+        }
+
+        /*
+        * Internal function, counts a parsed frame in the RX metrics (instance 0).
+        */
+        void count_frame(GDOOR_DATA *data) {
+            if constexpr (!primary) {
+                return;
+            }
+            GDOOR_METRICS::inc(GDOOR_METRICS::RX_FRAMES);
+            if (data->parity_errors) {
+                GDOOR_METRICS::inc(GDOOR_METRICS::RX_PARITY_ERRORS);
+            }
+            if (GDOOR_UTILS::crc(data->data, data->len-1) != data->data[data->len-1]) {
+                GDOOR_METRICS::inc(GDOOR_METRICS::RX_CHECKSUM_ERRORS);
+            }
+            if (!data->valid) {
+                GDOOR_METRICS::inc(GDOOR_METRICS::RX_INVALID);
+            }
+        }
+
+        /*
+        * Internal function, diversity reception: parses the secondary input
+        * and selects the valid copy, or combines both copies word by word.
+        * Counts how often each input alone would have failed.
+        * @param parsed true if the primary input (retval) was parsed
+        * @return true if retval holds a parsed frame
+        */
+        bool select_diversity(bool parsed) {
+            rx_channel &secondary = channels[1];
+            retval_secondary.timestamp = rx_start_time;
+            bool parsed_secondary = retval_secondary.parse<CONFIG>(secondary.counts, secondary.bitcounter);
+            count_edges(secondary, &retval_secondary);
+            if constexpr (primary) {
+                GDOOR_CAPTURE::record(secondary.counts, secondary.bitcounter, rx_start_time, CAPTURE_FLAG_SECONDARY
+                                      | (parsed_secondary ? (CAPTURE_FLAG_PARSED | (retval_secondary.valid ? CAPTURE_FLAG_VALID : 0)) : 0));
+            }
+            if (!parsed && !parsed_secondary) {
+                return false;
+            }
+
+            bool valid = parsed && retval.valid;
+            bool valid_secondary = parsed_secondary && retval_secondary.valid;
+            if constexpr (primary) {
+                GDOOR_THRESHOLD::observe(valid, valid_secondary);
+                if (!valid) {
+                    GDOOR_METRICS::inc(GDOOR_METRICS::RX_DIVERSITY_PRIMARY_ERRORS);
+                }
+                if (!valid_secondary) {
+                    GDOOR_METRICS::inc(GDOOR_METRICS::RX_DIVERSITY_SECONDARY_ERRORS);
+                }
+            }
+
+            if (!valid && valid_secondary) {
+                retval = retval_secondary;
+            } else if (!valid && parsed && parsed_secondary) {
+                bool combined = retval.combine(retval_secondary);
+                if constexpr (primary) {
+                    if (combined) {
+                        GDOOR_METRICS::inc(GDOOR_METRICS::RX_DIVERSITY_COMBINED);
+                    }
+                }
+            } else if (!parsed) {
+                retval = retval_secondary;
+            }
+            return true;
+        }
 };
 
-#endif
\ No newline at end of file
+template<class CONFIG, uint8_t INSTANCE> GDOOR_RX<CONFIG, INSTANCE> *GDOOR_RX<CONFIG, INSTANCE>::self = NULL;
+
+#endif
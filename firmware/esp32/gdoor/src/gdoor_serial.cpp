@@ -0,0 +1,278 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "gdoor_serial.h"
+#include "gdoor_metrics.h"
+#include "gdoor_utils.h"
+
+namespace GDOOR_SERIAL {
+    SERIAL_BINARY_SINK sink;
+    SERIAL_TEXT_PRINTER printer;
+
+    bool binary_mode = false;
+    uint8_t sequence = 0;
+
+    // COBS encoder, blocks of up to 254 non zero bytes
+    uint8_t block[254];
+    uint8_t block_len = 0;
+    bool block_full = false; // Last block had 254 bytes, it is not followed by a zero
+
+    // Host input, a decoded message stays in rx_buffer until it is received
+    uint8_t rx_buffer[SERIAL_MESSAGE_MAX + 2]; // COBS adds 2 bytes up to 508 bytes
+    uint16_t rx_len = 0;
+    bool rx_overflow = false;
+    uint8_t pending_type = 0; // 0: no message
+    uint8_t pending_sequence = 0;
+    uint16_t pending_len = 0; // Payload length, payload starts at rx_buffer[SERIAL_OFFSET_PAYLOAD]
+
+    /*
+    * Setup serial port.
+    * @param baud baud rate
+    * @param binary true: framed serial protocol, false: json lines
+    */
+    void setup(uint32_t baud, bool binary) {
+        binary_mode = binary;
+        Serial.flush();
+        Serial.end();
+        Serial.setRxBufferSize(SERIAL_RX_BUFFER); // Only possible before begin()
+        Serial.begin(baud);
+        Serial.setTimeout(1);
+    }
+
+    /* Returns true if the framed serial protocol is active */
+    bool binary() {
+        return binary_mode;
+    }
+
+    /*
+    * Switch serial protocol until restart.
+    * @param mode "json" or "binary"
+    * @return false if mode is unknown
+    */
+    bool set_mode(const String &mode) {
+        if (mode == "json") {
+            binary_mode = false;
+        } else if (mode == "binary") {
+            binary_mode = true;
+        } else {
+            return false;
+        }
+        rx_len = 0;
+        rx_overflow = false;
+        pending_type = 0;
+        return true;
+    }
+
+    /*
+    * Internal function, writes a COBS block with its code byte.
+    */
+    void write_block(uint8_t code) {
+        Serial.write(code);
+        Serial.write(block, block_len);
+        block_len = 0;
+    }
+
+    /*
+    * Internal function, COBS encodes data to Serial,
+    * can be called several times for one message.
+    */
+    void encode(const uint8_t *data, uint16_t len) {
+        for (uint16_t i=0; i<len; i++) {
+            if (data[i] == 0) {
+                write_block(block_len + 1);
+                block_full = false;
+            } else {
+                block[block_len++] = data[i];
+                if (block_len == sizeof(block)) {
+                    write_block(0xFF);
+                    block_full = true;
+                }
+            }
+        }
+    }
+
+    /*
+    * Sends one message of the framed serial protocol.
+    * @param type SERIAL_MSG_*
+    * @param payload message payload
+    * @param len length of payload
+    */
+    void send(uint8_t type, const uint8_t *payload, uint16_t len) {
+        uint8_t header[2] = {type, sequence++};
+        uint16_t crc = GDOOR_UTILS::crc16(header, 2);
+        crc = GDOOR_UTILS::crc16(payload, len, crc);
+        uint8_t trailer[2] = {(uint8_t)(crc & 0xFF), (uint8_t)(crc >> 8)};
+
+        block_len = 0;
+        block_full = false;
+        encode(header, 2);
+        encode(payload, len);
+        encode(trailer, 2);
+        if (block_len > 0 || !block_full) {
+            write_block(block_len + 1);
+        }
+        Serial.write((uint8_t)0);
+    }
+
+    /*
+    * Internal function, in place COBS decoder.
+    * @return decoded length, -1 on framing error
+    */
+    int16_t decode(uint8_t *data, uint16_t len) {
+        uint16_t in = 0;
+        uint16_t out = 0;
+        while (in < len) {
+            uint8_t code = data[in++];
+            if (in + code - 1 > len) {
+                return -1;
+            }
+            for (uint8_t i=1; i<code; i++) {
+                data[out++] = data[in++];
+            }
+            if (code < 0xFF && in < len) {
+                data[out++] = 0;
+            }
+        }
+        return out;
+    }
+
+    /*
+    * Internal function, acknowledges the pending host message
+    * and releases it.
+    * @param status SERIAL_ACK_*
+    */
+    void acknowledge(uint8_t status) {
+        uint8_t ack[3] = {pending_type, pending_sequence, status};
+        pending_type = 0;
+        send(SERIAL_MSG_ACK, ack, sizeof(ack));
+    }
+
+    /*
+    * Internal function, checks a complete host message in rx_buffer.
+    * Messages with framing or CRC error are dropped, as their type
+    * and sequence can not be trusted.
+    */
+    void check_message() {
+        int16_t len = rx_overflow ? -1 : decode(rx_buffer, rx_len);
+        if (len < SERIAL_FRAMING_LEN || GDOOR_UTILS::crc16(rx_buffer, len - 2) != (rx_buffer[len-2] | (rx_buffer[len-1] << 8))) {
+            GDOOR_METRICS::inc(GDOOR_METRICS::SERIAL_ERRORS);
+            return;
+        }
+        pending_type = rx_buffer[SERIAL_OFFSET_TYPE];
+        pending_sequence = rx_buffer[SERIAL_OFFSET_SEQUENCE];
+        pending_len = len - SERIAL_FRAMING_LEN;
+        if (pending_type != SERIAL_MSG_TX && pending_type != SERIAL_MSG_COMMAND) {
+            acknowledge(SERIAL_ACK_UNSUPPORTED);
+        }
+    }
+
+    /*
+    * Internal function, reads host input until a message is complete.
+    * @return true if a message is pending
+    */
+    bool poll() {
+        if (!binary_mode) {
+            return false;
+        }
+        while (pending_type == 0 && Serial.available() > 0) {
+            uint8_t c = Serial.read();
+            if (c != 0) {
+                if (rx_len < sizeof(rx_buffer)) {
+                    rx_buffer[rx_len++] = c;
+                } else {
+                    rx_overflow = true;
+                }
+                continue;
+            }
+            if (rx_len > 0) { // Empty frames can be used by the host to resync
+                check_message();
+            }
+            rx_len = 0;
+            rx_overflow = false;
+        }
+        return pending_type != 0;
+    }
+
+    /*
+    * Checks for a SERIAL_MSG_COMMAND.
+    * @param command returns the text
+    * @return true if a command was received
+    */
+    bool receive(String &command) {
+        if (!poll() || pending_type != SERIAL_MSG_COMMAND) {
+            return false;
+        }
+        rx_buffer[SERIAL_OFFSET_PAYLOAD + pending_len] = '\0'; // Overwrites the already checked CRC
+        command = (const char*)&rx_buffer[SERIAL_OFFSET_PAYLOAD];
+        acknowledge(SERIAL_ACK_OK);
+        return true;
+    }
+
+    /*
+    * Checks for a SERIAL_MSG_TX.
+    * @param data buffer for bus data, MAX_WORDLEN bytes
+    * @param len returns number of bus data bytes
+    * @return true if bus data was received
+    */
+    bool receive(uint8_t *data, uint16_t *len) {
+        if (!poll() || pending_type != SERIAL_MSG_TX) {
+            return false;
+        }
+        if (pending_len == 0 || pending_len >= MAX_WORDLEN) {
+            acknowledge(SERIAL_ACK_INVALID);
+            return false;
+        }
+        *len = pending_len;
+        memcpy(data, &rx_buffer[SERIAL_OFFSET_PAYLOAD], *len);
+        acknowledge(SERIAL_ACK_OK);
+        return true;
+    }
+}
+
+/** Returns true if the framed serial protocol is active*/
+bool SERIAL_BINARY_SINK::ready() {
+    return GDOOR_SERIAL::binary();
+}
+
+/**
+ * Sends one SERIAL_MSG_FRAME per bus frame.
+ * @param topic unused
+ * @param buffer binary frame
+ * @param len length of binary frame
+*/
+void SERIAL_BINARY_SINK::write(const char *topic, const uint8_t *buffer, uint16_t len, GDOOR_DATA *data) {
+    GDOOR_SERIAL::send(SERIAL_MSG_FRAME, buffer, len);
+}
+
+/**
+ * Print interface, longer texts are truncated.
+*/
+size_t SERIAL_TEXT_PRINTER::write(uint8_t c) {
+    if (index >= SERIAL_TEXT_MAX) {
+        return 0;
+    }
+    buffer[index++] = c;
+    return 1;
+}
+
+/**
+ * Sends the collected text and clears it.
+ * @param type SERIAL_MSG_MESSAGE or SERIAL_MSG_DEBUG
+*/
+void SERIAL_TEXT_PRINTER::send(uint8_t type) {
+    GDOOR_SERIAL::send(type, (const uint8_t*)buffer, index);
+    index = 0;
+}
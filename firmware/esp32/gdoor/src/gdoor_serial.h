@@ -0,0 +1,57 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GDOOR_SERIAL_H
+#define GDOOR_SERIAL_H
+#include <Arduino.h>
+#include "gdoor_sinks.h"
+#include "gdoor_formats.h" // SERIAL_MSG_*, SERIAL_ACK_*
+
+#define SERIAL_BOOT_BAUD 115200 // Until the configuration is loaded
+#define SERIAL_RX_BUFFER 1024
+
+#define SERIAL_MESSAGE_MAX 256 // Longest host message (type, sequence, payload, CRC)
+#define SERIAL_TEXT_MAX 256 // Longest log message, longer texts are truncated
+
+class SERIAL_BINARY_SINK : public GDOOR_SINK { // Bus frames as SERIAL_MSG_FRAME
+    public:
+        SERIAL_BINARY_SINK() : GDOOR_SINK(SINK_FORMAT_BINARY) {}
+        virtual bool ready();
+        virtual void write(const char *topic, const uint8_t *buffer, uint16_t len, GDOOR_DATA *data);
+};
+
+class SERIAL_TEXT_PRINTER : public Print { // Collects the text of one log message
+    public:
+        char buffer[SERIAL_TEXT_MAX];
+        uint16_t index = 0;
+
+        virtual size_t write(uint8_t c);
+        void send(uint8_t type);
+};
+
+namespace GDOOR_SERIAL { //Namespace as we can only use it once
+    extern SERIAL_BINARY_SINK sink;
+    extern SERIAL_TEXT_PRINTER printer;
+
+    void setup(uint32_t baud, bool binary);
+    bool binary();
+    bool set_mode(const String &mode);
+    void send(uint8_t type, const uint8_t *payload, uint16_t len);
+    bool receive(String &command);
+    bool receive(uint8_t *data, uint16_t *len);
+};
+
+#endif
@@ -0,0 +1,178 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "gdoor_sinks.h"
+#include "gdoor_latency.h"
+#include "gdoor_utils.h"
+#include "mqtt_helper.h"
+#include "gdoor_serial.h"
+
+extern boolean event_mode;
+
+/**
+ * Sends out json data via Serial,
+ * the topic is not part of the output.
+ * With the framed serial protocol, only json without bus data is send,
+ * bus frames are send by GDOOR_SERIAL::sink.
+*/
+void SERIAL_SINK::write(const char *topic, const uint8_t *buffer, uint16_t len, GDOOR_DATA *data) {
+    if (!GDOOR_SERIAL::binary()) {
+        Serial.write(buffer, len);
+    } else if (data == NULL) {
+        GDOOR_SERIAL::send(SERIAL_MSG_JSON, buffer, len);
+    }
+}
+
+namespace GDOOR_SINKS {
+    SERIAL_SINK serial;
+
+    GDOOR_SINK *sinks[SINKS_MAX];
+    uint8_t sink_count = 0;
+
+    /*
+    * Register an output.
+    * @param sink output, needs to exist as long as the firmware runs
+    * @return false if no slot is left
+    */
+    bool add(GDOOR_SINK *sink) {
+        if (sink_count >= SINKS_MAX) {
+            return false;
+        }
+        sinks[sink_count++] = sink;
+        return true;
+    }
+
+    /*
+    * Internal function, json serializer for bus messages,
+    * uses the MQTT_PRINTER buffer.
+    * @param message bus message
+    * @param buffer returns the serialized data
+    * @return length of serialized data
+    */
+    uint16_t serialize_json(GDOOR_DATA_PROTOCOL &message, const uint8_t **buffer) {
+        MQTT_HELPER::printer.print("{");
+        if (event_mode && message.raw != NULL) { // Home Assistant event entity needs the event_type
+            GDOOR_UTILS::print_json_string(MQTT_HELPER::printer, "event_type", message.action);
+            MQTT_HELPER::printer.print(", ");
+        }
+        MQTT_HELPER::printer.print(message);
+        MQTT_HELPER::printer.println("}");
+        if (message.raw != NULL) {
+            GDOOR_LATENCY::rx_mark(LATENCY_RX_SERIALIZED);
+        }
+        uint16_t len = MQTT_HELPER::printer.index;
+        *buffer = (const uint8_t*)MQTT_HELPER::printer.read();
+        return len;
+    }
+
+    /*
+    * Internal function, binary serializer for bus messages, see SINK_FORMAT_BINARY.
+    * The sequence number counts every serialized frame, gaps show lost frames.
+    * @param message bus message, messages without bus data (BUS_IDLE) are skipped
+    * @param buffer returns the serialized data
+    * @return length of serialized data, 0 if skipped
+    */
+    uint16_t serialize_binary(GDOOR_DATA_PROTOCOL &message, const uint8_t **buffer) {
+        static uint8_t binary[BINARY_HEADER_LEN + MAX_WORDLEN];
+        static uint32_t sequence = 0;
+        GDOOR_DATA *data = message.raw;
+        if (data == NULL) {
+            return 0;
+        }
+        binary[BINARY_OFFSET_MAGIC] = 'G';
+        binary[BINARY_OFFSET_MAGIC+1] = 'D';
+        binary[BINARY_OFFSET_VERSION] = BINARY_VERSION;
+        binary[BINARY_OFFSET_TYPE] = BINARY_TYPE_FRAME;
+        sequence++;
+        for (uint8_t i=0; i<4; i++) {
+            binary[BINARY_OFFSET_SEQUENCE+i] = sequence >> (8*i);
+            binary[BINARY_OFFSET_TIMESTAMP+i] = data->timestamp >> (8*i);
+        }
+        binary[BINARY_OFFSET_FLAGS] = data->valid ? BINARY_FLAG_VALID : 0;
+        binary[BINARY_OFFSET_LEN] = data->len;
+        memcpy(&binary[BINARY_HEADER_LEN], data->data, data->len);
+        *buffer = binary;
+        return BINARY_HEADER_LEN + data->len;
+    }
+
+    /*
+    * Internal function, serializes a bus message into a format.
+    * @return length of serialized data, 0 if the format is not available
+    */
+    uint16_t serialize(uint8_t format, GDOOR_DATA_PROTOCOL &message, const uint8_t **buffer) {
+        switch (format) {
+            case SINK_FORMAT_JSON:
+                return serialize_json(message, buffer);
+            case SINK_FORMAT_BINARY:
+                return serialize_binary(message, buffer);
+        }
+        return 0;
+    }
+
+    /*
+    * Sends a bus message to all outputs which accept it.
+    * Each format is only serialized once, if at least one
+    * output needs it, and the buffer is shared by these outputs.
+    * @param message bus message
+    * @param topic MQTT topic or channel name
+    * @param force true: ignore filters and rate limits, e.g. for BUS_IDLE
+    */
+    void publish_message(GDOOR_DATA_PROTOCOL &message, const char *topic, bool force) {
+        const uint8_t *buffers[SINK_FORMATS];
+        int32_t lengths[SINK_FORMATS];
+        for (uint8_t f=0; f<SINK_FORMATS; f++) {
+            lengths[f] = -1; // Not serialized yet
+        }
+
+        uint32_t now = millis();
+        for (uint8_t i=0; i<sink_count; i++) {
+            GDOOR_SINK *sink = sinks[i];
+            if (!sink->enabled || sink->format >= SINK_FORMATS || !sink->ready()) {
+                continue;
+            }
+            if (!force && sink->filter != NULL && (message.raw == NULL || !sink->filter(message.raw))) {
+                continue;
+            }
+            if (!force && sink->rate_limit_ms > 0 && now - sink->last_write < sink->rate_limit_ms) {
+                continue;
+            }
+            if (lengths[sink->format] < 0) {
+                lengths[sink->format] = serialize(sink->format, message, &buffers[sink->format]);
+            }
+            if (lengths[sink->format] > 0) {
+                sink->write(topic, buffers[sink->format], lengths[sink->format], message.raw);
+                sink->last_write = now;
+            }
+        }
+    }
+
+    /*
+    * Sends already serialized json data, e.g. diagnostics,
+    * to all json outputs. Filters and rate limits do not apply.
+    * @param topic MQTT topic or channel name
+    * @param buffer json data
+    * @param len length of json data
+    * @param periodic true: periodic data, skipped by outputs which do not want it
+    */
+    void publish(const char *topic, const uint8_t *buffer, uint16_t len, bool periodic) {
+        for (uint8_t i=0; i<sink_count; i++) {
+            GDOOR_SINK *sink = sinks[i];
+            if (sink->enabled && sink->format == SINK_FORMAT_JSON && (sink->periodic || !periodic) && sink->ready()) {
+                sink->write(topic, buffer, len, NULL);
+            }
+        }
+    }
+}
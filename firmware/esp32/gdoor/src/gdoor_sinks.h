@@ -0,0 +1,69 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GDOOR_SINKS_H
+#define GDOOR_SINKS_H
+#include <Arduino.h>
+#include "gdoor_data.h"
+#include "gdoor_formats.h" // BINARY_*, binary format of SINK_FORMAT_BINARY
+
+#define SINKS_MAX 8 // Number of registered outputs
+
+// Output formats, each is serialized at most once per bus message
+#define SINK_FORMAT_JSON 0
+#define SINK_FORMAT_BINARY 1
+#define SINK_FORMATS 2
+
+class GDOOR_SINK { // Output for bus messages and diagnostics
+    public:
+        uint8_t format; // SINK_FORMAT_*
+        uint16_t rate_limit_ms; // Minimum time between two bus messages, 0: unlimited
+        bool (*filter)(GDOOR_DATA *data); // Returns true if a bus message is send, NULL: all
+        bool periodic; // false: skip periodic diagnostics
+        bool enabled = true; // false: output is muted, e.g. Serial during a capture
+        uint32_t last_write = 0;
+
+        GDOOR_SINK(uint8_t format, uint16_t rate_limit_ms = 0, bool (*filter)(GDOOR_DATA *data) = NULL, bool periodic = true)
+            : format(format), rate_limit_ms(rate_limit_ms), filter(filter), periodic(periodic) {}
+
+        /* Returns false if the output can currently not send, e.g. not connected */
+        virtual bool ready() { return true; }
+
+        /*
+        * Sends out serialized data.
+        * @param topic MQTT topic or channel name
+        * @param buffer serialized data, shared with other sinks of the same format
+        * @param len length of buffer
+        * @param data bus data of the message, NULL for diagnostics and BUS_IDLE
+        */
+        virtual void write(const char *topic, const uint8_t *buffer, uint16_t len, GDOOR_DATA *data) = 0;
+};
+
+class SERIAL_SINK : public GDOOR_SINK { // Json lines via Serial
+    public:
+        SERIAL_SINK() : GDOOR_SINK(SINK_FORMAT_JSON, 0, NULL, false) {}
+        virtual void write(const char *topic, const uint8_t *buffer, uint16_t len, GDOOR_DATA *data);
+};
+
+namespace GDOOR_SINKS { //Namespace as we can only use it once
+    extern SERIAL_SINK serial;
+
+    bool add(GDOOR_SINK *sink);
+    void publish_message(GDOOR_DATA_PROTOCOL &message, const char *topic, bool force = false);
+    void publish(const char *topic, const uint8_t *buffer, uint16_t len, bool periodic = false);
+};
+
+#endif
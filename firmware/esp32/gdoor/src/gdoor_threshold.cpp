@@ -0,0 +1,304 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <LittleFS.h>
+#include "gdoor_threshold.h"
+#include "gdoor.h"
+#include "gdoor_utils.h"
+#include "printer_helper.h"
+
+namespace GDOOR_THRESHOLD {
+    enum threshold_state { FIXED, SWEEP, LOCKED };
+
+    threshold_state state = FIXED;
+    uint8_t pin_thresh = 0;
+    uint8_t dac = 0; // Current threshold, centre of the working window
+    uint8_t window_low = 0; // Working window, 0: unknown
+    uint8_t window_high = 0;
+    bool save_pending = false;
+    uint32_t adjustments = 0; // Threshold changes by adaptation
+
+    // Sweep
+    uint8_t steps = 0;
+    uint8_t step = 0;
+    uint8_t samples[THRESHOLD_STEPS_MAX];
+    uint8_t successes[THRESHOLD_STEPS_MAX];
+
+    // Adaptation, side 0: lower edge, 1: upper edge
+    uint8_t frame_count = 0;
+    int8_t probe_side = -1; // Edge the current threshold probes, -1: none
+    uint8_t next_side = 0;
+    uint8_t probes[2] = {0, 0};
+    uint8_t probe_failures[2] = {0, 0};
+
+    /*
+    * Internal function, DAC value of a voltage, as GDOOR::setRxThreshold.
+    */
+    uint8_t to_dac(float voltage) {
+        return (uint8_t)((voltage/3.3)*255 + 0.5);
+    }
+
+    float to_voltage(uint8_t value) {
+        return value*3.3/255;
+    }
+
+    /*
+    * Internal function, DAC value of a sweep step.
+    */
+    uint8_t step_value(uint8_t index) {
+        return to_dac(THRESHOLD_SWEEP_MIN) + index*THRESHOLD_SWEEP_STEP;
+    }
+
+    /*
+    * Internal function, limits a DAC value to the sweep range,
+    * so that window and threshold never wrap around 0/255.
+    */
+    uint8_t clamp_sweep(int16_t value) {
+        return constrain(value, (int16_t)to_dac(THRESHOLD_SWEEP_MIN), (int16_t)to_dac(THRESHOLD_SWEEP_MAX));
+    }
+
+    /*
+    * Internal function, probe distance from the centre,
+    * 3/4 of the way to the edges of the working window.
+    */
+    uint8_t margin() {
+        if (window_high <= window_low) {
+            return THRESHOLD_DEFAULT_MARGIN;
+        }
+        return max(1, (window_high - window_low)*3/8);
+    }
+
+    void apply(uint8_t value) {
+        GDOOR::setRxThresholdDac(pin_thresh, value);
+    }
+
+    /*
+    * Setup RX threshold.
+    * @param pin DAC pin of the threshold
+    * @param sensitivity fixed threshold (V), start value of the automatic mode
+    * @param automatic true: use the stored calibration, calibrate if there is none
+    */
+    void setup(uint8_t pin, float sensitivity, bool automatic) {
+        pin_thresh = pin;
+        dac = to_dac(sensitivity);
+        state = automatic ? LOCKED : FIXED;
+
+        bool calibrated = false;
+        if (automatic && LittleFS.begin(true)) {
+            File file = LittleFS.open(THRESHOLD_FILE, FILE_READ);
+            if (file && !file.isDirectory()) {
+                float centre = file.parseFloat();
+                window_low = clamp_sweep(to_dac(file.parseFloat()));
+                window_high = clamp_sweep(to_dac(file.parseFloat()));
+                calibrated = centre > 0;
+                if (calibrated) {
+                    dac = clamp_sweep(to_dac(centre));
+                }
+                file.close();
+            }
+            LittleFS.end();
+        }
+        apply(dac);
+        if (automatic && !calibrated) {
+            calibrate();
+        }
+    }
+
+    /*
+    * Needs to be called in main loop(), while the bus is idle,
+    * stores a new threshold.
+    */
+    void loop() {
+        if (!save_pending) {
+            return;
+        }
+        save_pending = false;
+        if (LittleFS.begin(true)) {
+            File file = LittleFS.open(THRESHOLD_FILE, FILE_WRITE, true);
+            if (file) {
+                file.print(to_voltage(dac), 3);
+                file.print(" ");
+                file.print(to_voltage(window_low), 3);
+                file.print(" ");
+                file.print(to_voltage(window_high), 3);
+                file.close();
+            }
+            LittleFS.end();
+        }
+    }
+
+    /*
+    * Starts a sweep of the threshold from THRESHOLD_SWEEP_MIN to THRESHOLD_SWEEP_MAX,
+    * it is finished when every step saw THRESHOLD_SWEEP_SAMPLES frames.
+    * @return false if the automatic mode is not enabled
+    */
+    bool calibrate() {
+        if (state == FIXED) {
+            return false;
+        }
+        steps = min(THRESHOLD_STEPS_MAX, (to_dac(THRESHOLD_SWEEP_MAX) - to_dac(THRESHOLD_SWEEP_MIN))/THRESHOLD_SWEEP_STEP + 1);
+        memset(samples, 0, sizeof(samples));
+        memset(successes, 0, sizeof(successes));
+        step = 0;
+        state = SWEEP;
+        apply(step_value(step));
+        return true;
+    }
+
+    /*
+    * Internal function, ends the sweep and locks onto the centre
+    * of the longest run of steps without error.
+    */
+    void finish_sweep() {
+        uint8_t best_start = 0;
+        uint8_t best_len = 0;
+        uint8_t run_start = 0;
+        for (uint8_t i=0; i<=steps; i++) {
+            if (i < steps && successes[i] == samples[i]) {
+                continue;
+            }
+            if (i - run_start > best_len) {
+                best_start = run_start;
+                best_len = i - run_start;
+            }
+            run_start = i + 1;
+        }
+        state = LOCKED;
+        if (best_len == 0) {
+            JSONPRINT("RX threshold calibration failed, keeping previous threshold");
+        } else {
+            window_low = step_value(best_start);
+            window_high = step_value(best_start + best_len - 1);
+            dac = (window_low + window_high)/2;
+            save_pending = true;
+        }
+        frame_count = 0;
+        probe_side = -1;
+        probes[0] = probes[1] = 0;
+        probe_failures[0] = probe_failures[1] = 0;
+        apply(dac);
+    }
+
+    /*
+    * Internal function, moves the threshold one DAC step away
+    * from the edge which fails more often.
+    */
+    void adapt() {
+        if (probes[0] < THRESHOLD_PROBES || probes[1] < THRESHOLD_PROBES) {
+            return;
+        }
+        int8_t direction = 0;
+        if (probe_failures[0] >= probe_failures[1] + 2) {
+            direction = 1;
+        } else if (probe_failures[1] >= probe_failures[0] + 2) {
+            direction = -1;
+        }
+        if (direction != 0 && clamp_sweep(dac + direction) != dac) {
+            dac = clamp_sweep(dac + direction);
+            if (window_high > window_low) {
+                window_low = clamp_sweep(window_low + direction);
+                window_high = clamp_sweep(window_high + direction);
+            }
+            adjustments++;
+            save_pending = true;
+        }
+        probes[0] = probes[1] = 0;
+        probe_failures[0] = probe_failures[1] = 0;
+    }
+
+    /*
+    * Called by GDOOR_RX for every bitstream in automatic mode, after
+    * the IO22 (current threshold) and IO21 (reference) copies are parsed.
+    * Frames neither input received valid are ignored, e.g. noise.
+    * @param valid IO22 copy is valid
+    * @param reference_valid IO21 copy is valid
+    */
+    void observe(bool valid, bool reference_valid) {
+        if (state == FIXED || (!valid && !reference_valid)) {
+            return;
+        }
+        if (state == SWEEP) {
+            samples[step]++;
+            if (valid) {
+                successes[step]++;
+            }
+            for (uint8_t i=1; i<=steps; i++) { // Next step which needs frames
+                uint8_t next = (step + i) % steps;
+                if (samples[next] < THRESHOLD_SWEEP_SAMPLES) {
+                    step = next;
+                    apply(step_value(step));
+                    return;
+                }
+            }
+            finish_sweep();
+            return;
+        }
+
+        if (probe_side >= 0) { // This frame was received at one edge
+            probes[probe_side]++;
+            if (!valid) {
+                probe_failures[probe_side]++;
+            }
+            probe_side = -1;
+            adapt();
+            apply(dac);
+        } else if (++frame_count >= THRESHOLD_PROBE_INTERVAL) { // Next frame probes an edge
+            frame_count = 0;
+            probe_side = next_side;
+            next_side ^= 1;
+            apply(probe_side == 0 ? max(0, dac - margin()) : min(255, dac + margin()));
+        }
+    }
+
+    /* Returns the current threshold (V), without probes */
+    float voltage() {
+        return to_voltage(dac);
+    }
+
+    /*
+    * Json compatible output of threshold state.
+    * "rx_threshold": {"mode": "auto", "state": "locked", "voltage": "1.45", ...}
+    */
+    size_t printTo(Print& p) {
+        const char *states[] = {"fixed", "sweep", "locked"};
+        size_t r = 0;
+        r+= p.print("\"rx_threshold\": {");
+        r+= GDOOR_UTILS::print_json_string(p, "mode", state == FIXED ? "fixed" : "auto");
+        r+= p.print(", ");
+        r+= GDOOR_UTILS::print_json_string(p, "state", states[state]);
+        r+= p.print(", ");
+        r+= GDOOR_UTILS::print_json_value<float>(p, "voltage", voltage());
+        if (state == SWEEP) {
+            uint8_t done = 0;
+            for (uint8_t i=0; i<steps; i++) {
+                done += (samples[i] >= THRESHOLD_SWEEP_SAMPLES);
+            }
+            r+= p.print(", ");
+            r+= GDOOR_UTILS::print_json_value<uint8_t>(p, "steps_done", done);
+            r+= p.print(", ");
+            r+= GDOOR_UTILS::print_json_value<uint8_t>(p, "steps", steps);
+        } else if (state == LOCKED && window_high > window_low) {
+            r+= p.print(", ");
+            r+= GDOOR_UTILS::print_json_value<float>(p, "window_low", to_voltage(window_low));
+            r+= p.print(", ");
+            r+= GDOOR_UTILS::print_json_value<float>(p, "window_high", to_voltage(window_high));
+            r+= p.print(", ");
+            r+= GDOOR_UTILS::print_json_value<uint32_t>(p, "adjustments", adjustments);
+        }
+        r+= p.print("}");
+        return r;
+    }
+}
@@ -0,0 +1,42 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GDOOR_THRESHOLD_H
+#define GDOOR_THRESHOLD_H
+#include <Arduino.h>
+
+// Automatic RX threshold (IO22), IO21 with its fixed threshold is the
+// reference, so frames are still received while the threshold is swept.
+#define THRESHOLD_FILE "/rx_threshold" // Voltages of threshold, window low and high
+#define THRESHOLD_SWEEP_MIN 1.0 // V
+#define THRESHOLD_SWEEP_MAX 2.0 // V
+#define THRESHOLD_SWEEP_STEP 4 // DAC steps (~50 mV)
+#define THRESHOLD_STEPS_MAX 32
+#define THRESHOLD_SWEEP_SAMPLES 3 // Frames per step
+#define THRESHOLD_DEFAULT_MARGIN 8 // DAC steps, probe distance if the window is unknown
+#define THRESHOLD_PROBE_INTERVAL 8 // Every n-th frame is received at one edge of the window
+#define THRESHOLD_PROBES 8 // Probes per edge, before the threshold is adapted
+
+namespace GDOOR_THRESHOLD { //Namespace as we can only use it once
+    void setup(uint8_t pin, float sensitivity, bool automatic);
+    void loop();
+    bool calibrate();
+    void observe(bool valid, bool reference_valid);
+    float voltage();
+    size_t printTo(Print& p);
+};
+
+#endif
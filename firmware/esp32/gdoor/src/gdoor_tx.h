@@ -18,12 +18,253 @@
 
 #define GDOOR_TX_H
 #include <Arduino.h>
+#include "defines.h"
+#include "gdoor_config.h"
+#include "gdoor_rx.h"
+#include "gdoor_utils.h"
+#include "gdoor_latency.h"
+#include "gdoor_metrics.h"
+#include "gdoor_busstats.h"
+#include "gdoor_correlation.h"
+#include "gdoor_history.h"
+#include "gdoor_isrstats.h"
 
-namespace GDOOR_TX { //Namespace as we can only use it once
-    extern uint16_t tx_state;
-    void send(uint8_t *words, uint16_t len);
-    void send(String str);
-    void setup(uint8_t txpin, uint8_t txenpin);
+/*
+* Transmitter of one bus interface.
+* @param CONFIG timings and buffer sizes, see gdoor_config.h
+* @param INSTANCE number of the bus interface, one object per INSTANCE,
+*        instance 0 feeds the diagnostics (metrics, ISR profiling, latency, history, ...)
+*/
+template<class CONFIG, uint8_t INSTANCE>
+class GDOOR_TX {
+    public:
+        static constexpr bool primary = (INSTANCE == 0);
+
+        uint16_t tx_state = 0;
+        volatile uint32_t tx_start_time = 0; // Timestamp (us) of first carrier pulse, 0 until sent
+        volatile uint32_t tx_end_time = 0; // Timestamp (us) when last bit was sent
+
+        /*
+        * Function called by user to setup everything needed for GDoor.
+        * @param int txpin Pin number where PWM is created when sending out data
+        * @param int txenpin Pin number where output buffer is turned on/off
+        * @param receiver RX of the same bus, disabled while sending
+        */
+        void setup(uint8_t txpin, uint8_t txenpin, GDOOR_RX<CONFIG, INSTANCE> *receiver) {
+            self = this;
+            rx = receiver;
+            pin_tx = txpin;
+            pin_tx_en = txenpin;
+
+            // Set timer_60khz timer frequency to 60kHz
+            timer_60khz = timerBegin(CONFIG::tx_pulse_freq);
+            timerStop(timer_60khz);
+
+            // Attach isr_timer_60khz function to timer_60khz timer.
+            timerAttachInterrupt(timer_60khz, &isr_timer_60khz);
+
+            // Set alarm to call isr_timer_60khz function
+            // after 1 60kHz Cycles
+            timerAlarm(timer_60khz, 1, true, 0);
+
+            pinMode(pin_tx, OUTPUT);
+            pinMode(pin_tx_en, OUTPUT);
+
+            digitalWrite(pin_tx_en, LOW);
+            digitalWrite(pin_tx, LOW);
+
+            //Setup PWM subsystem (LEDC) on pin_tx
+            // We only modulate with 52kHz, as the bandpass
+            // manufacturing tolerances are a bit on the lower side.
+            // Still works.
+            ledcAttach(pin_tx, CONFIG::tx_carrier_freq, 8);
+            ledcWrite(pin_tx, 0);
+
+            stop_timer();
+            bits_len = 0;
+            tx_state = 0;
+        }
+
+        /*
+        * Function called by user to send out data.
+        * @param data buffer with bus data
+        * @param len length of buffer, can be max CONFIG::max_wordlen
+        */
+        void send(uint8_t *data, uint16_t len) {
+            if (! (tx_state & STATE_SENDING) && len < CONFIG::max_wordlen) {
+                bits_ptr = 0;
+                pulse_cnt = 0;
+                bits_len = (uint16_t) (len*9 + 9); // Data bits + CRC (8bit CRC data + parity bit) (Startbit is added by timer int. routine)
+
+
+                for (uint16_t i=0; i<len; i++) {
+                    uint8_t byte = data[i];
+                    tx_words[i] = byte2word(byte);
+                }
+
+                uint8_t crc = GDOOR_UTILS::crc(data, len);
+                tx_words[len] = byte2word(crc);
+                if constexpr (primary) {
+                    GDOOR_METRICS::inc(GDOOR_METRICS::TX_FRAMES);
+                    GDOOR_LATENCY::tx_mark(LATENCY_TX_STARTED);
+                    GDOOR_BUSSTATS::tx_frame(data, len);
+                    GDOOR_CORRELATION::tx_request(data, len);
+                    GDOOR_HISTORY::add(data, len, HISTORY_FLAG_TX);
+                }
+                start_timer();
+            } else if constexpr (primary) {
+                GDOOR_METRICS::inc(GDOOR_METRICS::TX_REJECTED);
+                GDOOR_HISTORY::add(data, len, HISTORY_FLAG_TX | HISTORY_FLAG_REJECTED);
+            }
+        }
+
+        /*
+        * Function called by user to send out data.
+        * @param hex string data without 0x prefix
+        */
+        void send(String str) {
+            // The checksum word is added, so at most max_wordlen-1 bytes
+            int16_t len = GDOOR_UTILS::parse_hexstring(str, tx_strbuffer, CONFIG::max_wordlen-1);
+            if (len > 0) {
+                send(tx_strbuffer, len);
+            } else if constexpr (primary) {
+                GDOOR_METRICS::inc(GDOOR_METRICS::TX_REJECTED);
+            }
+        }
+
+    private:
+        uint16_t tx_words[CONFIG::max_wordlen];
+        uint8_t tx_strbuffer[CONFIG::max_wordlen];
+        uint16_t bits_len = 0;
+        uint16_t bits_ptr = 0;
+        uint16_t pulse_cnt = 0;
+        uint8_t startbit_send = 0;
+
+        uint8_t timer_oc_state = 0;
+
+        uint8_t pin_tx = 0;
+        uint8_t pin_tx_en = 0;
+
+        hw_timer_t* timer_60khz = NULL;
+        GDOOR_RX<CONFIG, INSTANCE> *rx = NULL;
+
+        static GDOOR_TX *self; // Object of this INSTANCE, used by the ISR
+
+        /*
+        * ISR trampoline, generated per INSTANCE
+        */
+        static void ARDUINO_ISR_ATTR isr_timer_60khz() {
+            if constexpr (primary) { // ISR profiling measures instance 0 only
+                ISRSTATS_BEGIN();
+                ISRSTATS_PERIOD(ISRSTATS_TIMER_60KHZ_PERIOD);
+                self->pulse();
+                ISRSTATS_END(ISRSTATS_TIMER_60KHZ);
+            } else {
+                self->pulse();
+            }
+        }
+
+        static inline uint16_t bit2pulselen(uint16_t bit) {
+            if (bit) {
+                return CONFIG::one_pulsenum;
+            } else {
+                return CONFIG::zero_pulsenum;
+            }
+        }
+
+        static inline uint16_t extractBitLen(uint16_t word, uint8_t bitindex) {
+            return bit2pulselen((uint16_t) (word & (uint16_t)(0x01<<bitindex))); //LSB first
+        }
+
+        static inline uint16_t byte2word(uint8_t byte) {
+            uint16_t value = byte & 0x00FF;
+            if(GDOOR_UTILS::parity_odd(byte)) { //If parity, set MSB
+                value |= 0x100;
+            }
+            return value;
+        }
+
+        inline void start_timer() {
+            tx_state |= STATE_SENDING;
+            bits_ptr = 0;
+            pulse_cnt = 0;
+            timer_oc_state = 0;
+            startbit_send = 0;
+            tx_start_time = 0;
+            if constexpr (primary) {
+                ISRSTATS_PERIOD_RESET();
+            }
+
+            //Workaround: Disable comparator to not be disturbed by receive.
+            //Better sending scheme is needed
+            rx->disable();
+
+            //TX Enable Pin high
+            digitalWrite(pin_tx_en, HIGH);
+
+            timerStart(timer_60khz); //Start timer 2 to send out bitstream
+        }
+
+        inline void stop_timer() {
+            //timer_set_outputcompare(&htim2, 0);
+            bits_ptr = 0;
+            pulse_cnt = 0;
+            startbit_send = 0;
+
+            // PWM off
+            ledcWrite(pin_tx, 0);
+
+            //TX Enable Pin Low
+            digitalWrite(pin_tx_en, LOW);
+            timerStop(timer_60khz);
+            if (tx_state & STATE_SENDING) {
+                tx_end_time = micros();
+            }
+            tx_state &= (uint16_t)~STATE_SENDING;
+            //Workaround: Enable comparator after sending
+            //Better sending scheme is needed
+            rx->enable();
+        }
+
+        /*
+        * This is the sending timer interrupt, once per 60kHz pulse
+        */
+        inline __attribute__((always_inline)) void pulse() {
+            if(pulse_cnt == 0) { // Update timer, we send out (or waited) enough timer ticks to go to next bit
+                if (bits_ptr >= bits_len || bits_ptr >= CONFIG::max_wordlen*9) {//We send everything
+                    stop_timer();
+                    return;
+                }
+
+                if(timer_oc_state == 1) {
+                    // Do not send next 60khz pulses, but send pause (nothing)
+                    timer_oc_state = 0;
+                    pulse_cnt = CONFIG::pause_pulsenum;
+                    ledcWrite(pin_tx, 0); //disable timer pulse output to send pause
+                } else {
+                    // Load new tick values
+                    if (!startbit_send) { //First bit, is start bit with fixed value
+                        tx_start_time = micros();
+                        pulse_cnt = CONFIG::startbit_pulsenum;
+                        startbit_send = 1;
+                    } else { //Startbit was send, so load bit values now
+                        uint8_t wordindex = (uint8_t) bits_ptr/9;
+                        uint8_t bitindex = (uint8_t) bits_ptr%9;
+                        uint16_t word = tx_words[wordindex];
+
+                        pulse_cnt = extractBitLen(word, bitindex);
+                        bits_ptr = bits_ptr + 1;
+                    }
+
+                    timer_oc_state = 1; //Signal that we are sending, so next time a pause will happen
+                    ledcWrite(pin_tx, 127); //Enable timer pulse output to send pulses forming the bit
+                }
+            } else { // Just update timer ticks, we are not finished yet
+                pulse_cnt = pulse_cnt - 1;
+            }
+        }
 };
 
-#endif
\ No newline at end of file
+template<class CONFIG, uint8_t INSTANCE> GDOOR_TX<CONFIG, INSTANCE> *GDOOR_TX<CONFIG, INSTANCE>::self = NULL;
+
+#endif
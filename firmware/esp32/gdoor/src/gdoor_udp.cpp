@@ -0,0 +1,139 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include "gdoor_udp.h"
+#include "printer_helper.h"
+
+namespace GDOOR_UDP {
+    UDP_SINK sink;
+
+    WiFiUDP udp;
+    IPAddress target_ip;
+    uint16_t target_port = UDP_DEFAULT_PORT;
+    bool enabled = false;
+    bool started = false; // Socket is opened once WiFi is connected
+    IPAddress tx_sender; // Only source of TX datagrams
+    bool tx_enabled = false;
+
+    /*
+    * Setup UDP stream.
+    * @param target "<ip>[:<port>]", a multicast group (224.0.0.0 - 239.255.255.255)
+    *        or a unicast receiver, NULL disables the stream
+    * @return false if target could not be parsed, stream is disabled then
+    */
+    bool setup(const char *target) {
+        enabled = false;
+        if (target == NULL) {
+            return true;
+        }
+        String s(target);
+        int split = s.indexOf(':');
+        if (split >= 0) {
+            target_port = s.substring(split + 1).toInt();
+            s = s.substring(0, split);
+        }
+        if (!target_ip.fromString(s.c_str()) || target_port == 0) {
+            return false;
+        }
+        enabled = true;
+        return true;
+    }
+
+    /*
+    * Setup UDP TX, bus data sent to the stream port.
+    * Off by default, as anybody in the network could ring or open the door otherwise.
+    * @param sender IP which may send TX datagrams, NULL disables UDP TX
+    * @return false if sender could not be parsed, UDP TX is disabled then
+    */
+    bool setup_tx(const char *sender) {
+        tx_enabled = sender != NULL && tx_sender.fromString(sender);
+        return sender == NULL || tx_enabled;
+    }
+
+    /*
+    * Internal function, opens the socket once WiFi is connected.
+    * Multicast streams also listen for TX datagrams on the group,
+    * unicast streams on the target port.
+    * @return true if socket is open
+    */
+    bool start() {
+        if (!enabled) {
+            return false;
+        }
+        if (WiFi.status() != WL_CONNECTED) {
+            if (started) { // Reopen after reconnect, multicast membership is lost
+                udp.stop();
+                started = false;
+            }
+            return false;
+        }
+        if (!started) {
+            if (target_ip[0] >= 224 && target_ip[0] <= 239) {
+                started = udp.beginMulticast(target_ip, target_port);
+            } else {
+                started = udp.begin(target_port);
+            }
+        }
+        return started;
+    }
+
+    /*
+    * Checks for a TX datagram (BINARY_TYPE_TX, see gdoor_sinks.h),
+    * own frames, malformed datagrams and datagrams of other senders than
+    * the configured one are ignored, all if UDP TX is disabled.
+    * @param data buffer for bus data, MAX_WORDLEN bytes
+    * @param len returns number of bus data bytes
+    * @return true if bus data was received
+    */
+    bool receive(uint8_t *data, uint16_t *len) {
+        if (!start() || udp.parsePacket() <= 0) {
+            return false;
+        }
+        uint8_t datagram[BINARY_HEADER_LEN + MAX_WORDLEN];
+        int n = udp.read(datagram, sizeof(datagram)); // Also drains datagrams which are ignored
+        if (!tx_enabled || udp.remoteIP() != tx_sender) {
+            return false;
+        }
+        uint8_t data_len = datagram[BINARY_OFFSET_LEN];
+        if (n < BINARY_HEADER_LEN || datagram[BINARY_OFFSET_MAGIC] != 'G' || datagram[BINARY_OFFSET_MAGIC+1] != 'D'
+            || datagram[BINARY_OFFSET_VERSION] != BINARY_VERSION || datagram[BINARY_OFFSET_TYPE] != BINARY_TYPE_TX
+            || data_len == 0 || data_len >= MAX_WORDLEN || n < BINARY_HEADER_LEN + data_len) {
+            return false;
+        }
+        *len = data_len;
+        memcpy(data, &datagram[BINARY_HEADER_LEN], *len);
+        return true;
+    }
+}
+
+/** Returns true if stream is enabled and WiFi is connected*/
+bool UDP_SINK::ready() {
+    return GDOOR_UDP::start();
+}
+
+/**
+ * Sends one datagram per bus frame.
+ * @param topic unused
+ * @param buffer binary frame
+ * @param len length of binary frame
+*/
+void UDP_SINK::write(const char *topic, const uint8_t *buffer, uint16_t len, GDOOR_DATA *data) {
+    GDOOR_UDP::udp.beginPacket(GDOOR_UDP::target_ip, GDOOR_UDP::target_port);
+    GDOOR_UDP::udp.write(buffer, len);
+    GDOOR_UDP::udp.endPacket();
+}
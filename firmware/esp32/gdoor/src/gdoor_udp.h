@@ -0,0 +1,39 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GDOOR_UDP_H
+#define GDOOR_UDP_H
+#include <Arduino.h>
+#include "gdoor_sinks.h"
+
+#define UDP_DEFAULT_PORT 5071
+
+class UDP_SINK : public GDOOR_SINK { // Binary frames via UDP multicast or unicast
+    public:
+        UDP_SINK() : GDOOR_SINK(SINK_FORMAT_BINARY) {}
+        virtual bool ready();
+        virtual void write(const char *topic, const uint8_t *buffer, uint16_t len, GDOOR_DATA *data);
+};
+
+namespace GDOOR_UDP { //Namespace as we can only use it once
+    extern UDP_SINK sink;
+
+    bool setup(const char *target);
+    bool setup_tx(const char *sender);
+    bool receive(uint8_t *data, uint16_t *len);
+};
+
+#endif
@@ -17,25 +17,112 @@
 #include "gdoor_utils.h"
 
 namespace GDOOR_UTILS {
-    uint8_t crc(uint8_t *words, uint16_t len) {
-        uint8_t crc = 0;
-        for(uint16_t i=0; i<len; i++) {//iterate over all words
-            crc = crc + words[i];
+    /*
+    * FNV-1a hash, used to detect identical bus frames.
+    */
+    uint32_t hash(const uint8_t *data, uint16_t len) {
+        uint32_t h = 2166136261UL;
+        for(uint16_t i=0; i<len; i++) {
+            h = (h ^ data[i]) * 16777619UL;
+        }
+        return h;
+    }
+
+    /*
+    * CRC-16/CCITT-FALSE (polynomial 0x1021), used by the framed serial protocol.
+    * @param crc previous value, to continue a CRC over several buffers
+    */
+    uint16_t crc16(const uint8_t *data, uint16_t len, uint16_t crc) {
+        for(uint16_t i=0; i<len; i++) {
+            crc ^= (uint16_t)data[i] << 8;
+            for(uint8_t bit=0; bit<8; bit++) {
+                crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+            }
         }
         return crc;
     }
 
-    uint8_t parity_odd(uint8_t word)
-    {
-        uint8_t ones = 0;
+    /*
+    * Returns data as upper case hex string without 0x prefix, e.g. "A286B1".
+    */
+    String hexstring(const uint8_t *data, uint16_t len) {
+        const char hexchars[] = "0123456789ABCDEF";
+        String s;
+        s.reserve(len*2);
+        for(uint16_t i=0; i<len; i++) {
+            s += hexchars[data[i] >> 4];
+            s += hexchars[data[i] & 0x0F];
+        }
+        return s;
+    }
 
-        while(word != 0) {
-            ones++;
-            word &= (uint8_t)(word-1);
+    /*
+    * Converts a hex string without 0x prefix, e.g. "A286B1", to bytes.
+    * @param str hex string, upper or lower case
+    * @param data output buffer
+    * @param maxlen size of output buffer
+    * @return number of bytes, -1 on parse error or if data is too small
+    */
+    int16_t parse_hexstring(const String &str, uint8_t *data, uint16_t maxlen) {
+        if (str.length() % 2 != 0 || str.length()/2 > maxlen) {
+            return -1;
+        }
+        for(uint16_t i=0; i<str.length(); i+=2) {
+            uint8_t byte = 0;
+            for(uint8_t j=0; j<2; j++) {
+                char c = str[i+j];
+                byte = byte << 4;
+                if (c >= '0' && c <= '9') {
+                    byte |= c - '0';
+                } else if (c >= 'A' && c <= 'F') {
+                    byte |= c - 'A' + 10;
+                } else if (c >= 'a' && c <= 'f') {
+                    byte |= c - 'a' + 10;
+                } else {
+                    return -1;
+                }
+            }
+            data[i/2] = byte;
         }
+        return str.length()/2;
+    }
 
-        /* if ones is odd, least significant bit will be 1 */
-        return ones &0x01;
+    /*
+    * Minimal lookup of a value in a flat json object,
+    * e.g. json_value("{\"action\": \"DOOR_OPEN\"}", "action", value) sets value to DOOR_OPEN.
+    * Nested objects, arrays and escaped quotes are not supported.
+    * @return true if the key was found
+    */
+    bool json_value(const String &json, const char *keyname, String &value) {
+        String key = String("\"") + keyname + "\"";
+        int start = json.indexOf(key);
+        if (start < 0) {
+            return false;
+        }
+        start = json.indexOf(':', start + key.length());
+        if (start < 0) {
+            return false;
+        }
+        start++;
+        while (start < (int)json.length() && json[start] == ' ') {
+            start++;
+        }
+        int end;
+        if (start < (int)json.length() && json[start] == '"') {
+            start++;
+            end = json.indexOf('"', start);
+        } else {
+            end = json.indexOf(',', start);
+            if (end < 0) {
+                end = json.indexOf('}', start);
+            }
+        }
+        if (end < 0) {
+            return false;
+        }
+        value = json.substring(start, end);
+        value.trim();
+        return true;
     }
 
     size_t print_json_string(Print& p, const char *keyname, const char *value) {
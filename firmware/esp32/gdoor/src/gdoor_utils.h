@@ -17,10 +17,14 @@
 #ifndef GDOOR_UTILS_H
 #define GDOOR_UTILS_H
 #include <Arduino.h>
+#include "gdoor_decoder.h"
 
 namespace GDOOR_UTILS {
-    uint8_t crc(uint8_t *words, uint16_t len);
-    uint8_t parity_odd(uint8_t word);
+    uint32_t hash(const uint8_t *data, uint16_t len);
+    uint16_t crc16(const uint8_t *data, uint16_t len, uint16_t crc = 0xFFFF);
+    String hexstring(const uint8_t *data, uint16_t len);
+    int16_t parse_hexstring(const String &str, uint8_t *data, uint16_t maxlen);
+    bool json_value(const String &json, const char *keyname, String &value);
 
     /*
     * Template Function (needs to live in header file),
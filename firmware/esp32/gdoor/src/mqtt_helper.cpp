@@ -18,6 +18,8 @@
 #include "mqtt_helper.h"
 #include "printer_helper.h"
 #include "gdoor_data.h"
+#include "gdoor_latency.h"
+#include "gdoor_metrics.h"
 #include <MQTT.h>
 
 #include <WiFi.h>
@@ -30,15 +32,31 @@ MQTT_PRINTER::MQTT_PRINTER(MQTTClient *mqttClient) {
 }
 
 /**
- * Sends out the collected data via Serial and MQTT (if available).
+ * Sends out the collected data to all json outputs (MQTT, Serial, ...).
  * @param topic The MQTT topic to which the collected data is send.
+ * @param serial false: periodic data, not send via Serial
 */
-void MQTT_PRINTER::publish(const char *topic) {
+void MQTT_PRINTER::publish(const char *topic, bool serial) {
     JSONDEBUG("MQTT_PRINTER publish()");
-    if (this->mqttClient->connected()) {
-        this->mqttClient->publish(topic, this->read());
-    }
-    PRINT(this->read());
+    uint16_t len = this->index;
+    const uint8_t *data = (const uint8_t*)this->read();
+    GDOOR_SINKS::publish(topic, data, len, !serial);
+}
+
+/** Returns true if connected to the MQTT broker*/
+bool MQTT_SINK::ready() {
+    return this->mqttClient->connected();
+}
+
+/**
+ * Publishes json data.
+ * @param topic MQTT topic
+ * @param buffer json data
+ * @param len length of json data
+*/
+void MQTT_SINK::write(const char *topic, const uint8_t *buffer, uint16_t len, GDOOR_DATA *data) {
+    this->mqttClient->publish(topic, (const char*)buffer, len);
+    GDOOR_LATENCY::rx_mark(LATENCY_RX_PUBLISHED); // Ignored if no bus frame is traced
 }
 
 /**
@@ -53,6 +71,7 @@ size_t MQTT_PRINTER::write(uint8_t byte) {
         return 1;
     } else {
         JSONDEBUG("!!WARNING MQTT_PRINTER OUTPUT OVERFLOW, LOOSING DATA!!");
+        overflow = true;
     }
     return 0;
 }
@@ -65,13 +84,17 @@ char* MQTT_PRINTER::read() {
     if(this->index < BUFFER_SIZE && this->index > 0) {
         this->buffer[index] = '\0'; //just to be sure
     }
+    if(this->overflow) { // Count once per message, not per lost byte
+        this->overflow = false;
+        GDOOR_METRICS::inc(GDOOR_METRICS::MQTT_PRINTER_OVERFLOWS);
+    }
     this->index = 0;
     return this->buffer;
 }
 
 namespace MQTT_HELPER { //Namespace as we can only use it once
     WiFiClient net; // Arduinio helper object, needed by MQTTClient
-    MQTTClient mqttClient; // MQTT Library object
+    MQTTClient mqttClient(MQTT_PACKET_SIZE); // MQTT Library object, default buffer is 128 bytes
 
     const char* rx_topic_name; // Which callback topic
     const char* tx_topic_name; // For HA discovery message
@@ -79,8 +102,10 @@ namespace MQTT_HELPER { //Namespace as we can only use it once
     const char* password; // Password
 
     MQTT_PRINTER printer(&mqttClient); // Printer, so that code can use the Arduino print functions
+    MQTT_SINK sink(&mqttClient); // Output for bus messages and diagnostics, see GDOOR_SINKS
 
     String received_mqtt_payload; // Global variable which stores received MQTT payload
+    uint32_t received_mqtt_time = 0; // Timestamp (us) when received_mqtt_payload arrived
     String empty(""); //Empty string, useful as global and fixed allocated value.
     String availability_topic; //Topic where availabiliy is shown
 
@@ -89,6 +114,36 @@ namespace MQTT_HELPER { //Namespace as we can only use it once
     bool newly_connected = true; // Global variable to indicate a newly established WIFI connection
     bool new_connection_established = false; //Global variable to indicate we successfully connected new
     bool ha_online = false; // Indicates if Home assistant messaged a new online state, so that we can resend our state
+    bool event_mode = false; // true: Bus messages are announced as Home Assistant events, no BUS_IDLE reset needed
+
+    /**
+     * Function which sends home assistant discovery message for the event entity,
+     * used in event mode. Every bus message is one event, its action is the event type.
+     * @param mac WiFi MAC address
+     * @param mac_clean WiFi MAC address with "_" as separator
+    */
+    void send_ha_event_discovery(const String &mac, const String &mac_clean) {
+        String message = "{";
+        message += "\"name\": \"Bus Event\",";
+        message += "\"icon\": \"mdi:door\",";
+        message += "\"device\": {";
+        message += "\"name\": \"GDoor Adapter\",";
+        message += "\"manufacturer\": \"GDoor Project\",";
+        message += "\"sw_version\": \"" + String(GDOOR_VERSION) + "\",";
+        message += "\"model\": \"ESP32 (" + mac + ")\",";
+        message += "\"configuration_url\": \"http://" + WiFi.localIP().toString() + "\",";
+        message += "\"ids\": \"gdoor_" + mac_clean + "\"";
+        message += "},";
+        message += "\"availability_topic\": \"" + availability_topic + "\",";
+        message += "\"uniq_id\": \"gdoor_event_" + mac_clean + "\",";
+        message += "\"state_topic\": \"" + String(tx_topic_name) + "\",";
+        message += "\"event_types\": [\"ACTION_UNKOWN\"";
+        for (auto const &action : GDOOR_DATA_ACTION) {
+            message += ", \"" + String(action.second) + "\"";
+        }
+        message += "]}";
+        mqttClient.publish("homeassistant/event/gdoor/data/config", message, true, 1);
+    }
 
     /**
      * Function which sends home assistant discovery message,
@@ -147,7 +202,41 @@ R"""(
         message += "\"json_attributes_topic\": \"" + String(tx_topic_name) + "\",";
         message += "\"command_topic\": \"" + String(rx_topic_name) + "\"";
         message += "}";
-        mqttClient.publish("homeassistant/sensor/gdoor/data/config", message, true, 1); 
+        if (event_mode) { // Replace sensor with event entity
+            mqttClient.publish("homeassistant/sensor/gdoor/data/config", "", true, 1);
+            send_ha_event_discovery(mac, mac_clean);
+        } else {
+            mqttClient.publish("homeassistant/sensor/gdoor/data/config", message, true, 1); 
+            mqttClient.publish("homeassistant/event/gdoor/data/config", "", true, 1);
+        }
+    }
+
+    /**
+     * Function which sends a home assistant discovery message
+     * for one device on the bus, as sensor of the GDoor Adapter device.
+     * @param source Bus address of the device as hex string
+     * @param type Hardware type of the device
+     * @param topic Device topic prefix, with <topic>/last_action and <topic>/state
+     * @return true if the message was sent
+    */
+    bool send_ha_device_discovery(const String &source, const char* type, const String &topic) {
+        if (!mqttClient.connected()) {
+            return false;
+        }
+        String mac = WiFi.macAddress();
+        String mac_clean = mac;
+        mac_clean.replace(":", "_");
+
+        String message = "{";
+        message += "\"name\": \"" + String(type) + " " + source + "\",";
+        message += "\"icon\": \"mdi:doorbell\",";
+        message += "\"device\": {\"ids\": \"gdoor_" + mac_clean + "\"},";
+        message += "\"availability_topic\": \"" + availability_topic + "\",";
+        message += "\"uniq_id\": \"gdoor_" + mac_clean + "_" + source + "\",";
+        message += "\"state_topic\": \"" + topic + "/last_action\",";
+        message += "\"json_attributes_topic\": \"" + topic + "/state\"";
+        message += "}";
+        return mqttClient.publish("homeassistant/sensor/gdoor_" + mac_clean + "/" + source + "/config", message, true, 1);
     }
 
     void setWill() {
@@ -169,6 +258,7 @@ R"""(
             ha_online = true;
         }
         new_string_available = true;
+        received_mqtt_time = micros();
         received_mqtt_payload = payload;
         received_mqtt_payload.trim();
     }
@@ -189,8 +279,9 @@ R"""(
      * @param pw MQTT Broker password
      * @param rx_topic Topic from which data is received
      * @param tx_topic Topic from which is announced in HA discovery as bus outgoing topic
+     * @param events true: additionally announce a Home Assistant event entity
     */
-    void setup(const char* server, int port, const char* username, const char* pw, const char* rx_topic, const char* tx_topic) {
+    void setup(const char* server, int port, const char* username, const char* pw, const char* rx_topic, const char* tx_topic, bool events) {
         WiFi.onEvent(on_wifi_active, WiFiEvent_t::ARDUINO_EVENT_WIFI_STA_GOT_IP);
         
         mqttClient.begin(server, port, net);
@@ -199,6 +290,7 @@ R"""(
         tx_topic_name = tx_topic;
         user = username;
         password = pw;
+        event_mode = events;
     }
 
     /**
@@ -212,7 +304,12 @@ R"""(
                 JSONDEBUG("Newly connected WIFI detected in MQTT loop");
                 setWill();
                 if (mqttClient.connect("GDoor", user, password)) {
+                    static bool first_connect = true;
                     JSONDEBUG("Successfully connected MQTT");
+                    if (!first_connect) {
+                        GDOOR_METRICS::inc(GDOOR_METRICS::MQTT_RECONNECTS);
+                    }
+                    first_connect = false;
                     mqttClient.subscribe(rx_topic_name);
                     mqttClient.subscribe("homeassistant/status");
 
@@ -259,6 +356,23 @@ R"""(
         return empty;
     }
 
+    /**
+     * Publish a message, if MQTT is connected.
+     * @param topic MQTT topic
+     * @param payload Message
+     * @param retained true: broker keeps the message for new subscribers
+    */
+    void publish(const String &topic, const String &payload, bool retained) {
+        if (mqttClient.connected()) {
+            mqttClient.publish(topic, payload, retained, 0);
+        }
+    }
+
+    /** Returns timestamp (us) of the last received MQTT message*/
+    uint32_t receive_time() {
+        return received_mqtt_time;
+    }
+
     /** Returns true if MQTT was newly connected since last call*/
     bool isNewConnection() {
         static uint16_t counter = 0;
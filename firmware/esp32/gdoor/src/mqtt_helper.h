@@ -19,29 +19,45 @@
 #define MQTT_HELPER_H
 #include <Arduino.h>
 #include <MQTT.h>
+#include "gdoor_sinks.h"
 
-#define BUFFER_SIZE 2048
+#define BUFFER_SIZE 4096
+#define MQTT_PACKET_SIZE (BUFFER_SIZE + 256) // MQTTClient read/write buffer, a whole printer message plus topic, e.g. *macro/*rule commands
 
 class MQTT_PRINTER : public Print { // Class/Struct to collect bus related infos
     public:
         MQTTClient *mqttClient;
         char buffer[BUFFER_SIZE + 1];
         uint16_t index = 0;
+        bool overflow = false;
 
         MQTT_PRINTER(MQTTClient *mqttClient);
 
-        void publish(const char *topic);
+        void publish(const char *topic, bool serial = true);
         size_t write(uint8_t byte);
         char* read();
 };
 
+class MQTT_SINK : public GDOOR_SINK { // Json via MQTT, if connected
+    public:
+        MQTTClient *mqttClient;
+
+        MQTT_SINK(MQTTClient *mqttClient) : GDOOR_SINK(SINK_FORMAT_JSON), mqttClient(mqttClient) {}
+        virtual bool ready();
+        virtual void write(const char *topic, const uint8_t *buffer, uint16_t len, GDOOR_DATA *data);
+};
+
 namespace MQTT_HELPER { //Namespace as we can only use it once
     extern MQTT_PRINTER printer;
+    extern MQTT_SINK sink;
 
-    void setup(const char* server, int port, const char* username, const char* pw, const char* rx_topic, const char* tx_topic);
+    void setup(const char* server, int port, const char* username, const char* pw, const char* rx_topic, const char* tx_topic, bool events = false);
     String& receive();
+    uint32_t receive_time();
     void loop();
     bool isNewConnection();
+    void publish(const String &topic, const String &payload, bool retained);
+    bool send_ha_device_discovery(const String &source, const char* type, const String &topic);
 };
 
 #endif
\ No newline at end of file
@@ -18,21 +18,34 @@
 #ifndef PRINTER_HELPER_H
 #define PRINTER_HELPER_H
 #include <Arduino.h>
+#include "gdoor_serial.h"
 
 extern boolean debug;
 
+// With the framed serial protocol, the text is send as its own message type
+
 #define JSONDEBUG(...) { \
             if(debug) { \
-                Serial.print("{\"debug\": \""); \
-                Serial.print(__VA_ARGS__); \
-                Serial.println("\"}"); \
+                if(GDOOR_SERIAL::binary()) { \
+                    GDOOR_SERIAL::printer.print(__VA_ARGS__); \
+                    GDOOR_SERIAL::printer.send(SERIAL_MSG_DEBUG); \
+                } else { \
+                    Serial.print("{\"debug\": \""); \
+                    Serial.print(__VA_ARGS__); \
+                    Serial.println("\"}"); \
+                } \
             }\
         }
 
 #define JSONPRINT(...) { \
-            Serial.print("{\"message\": \""); \
-            Serial.print(__VA_ARGS__); \
-            Serial.println("\"}"); \
+            if(GDOOR_SERIAL::binary()) { \
+                GDOOR_SERIAL::printer.print(__VA_ARGS__); \
+                GDOOR_SERIAL::printer.send(SERIAL_MSG_MESSAGE); \
+            } else { \
+                Serial.print("{\"message\": \""); \
+                Serial.print(__VA_ARGS__); \
+                Serial.println("\"}"); \
+            } \
         }
 
 #define PRINT(...) { \
@@ -18,7 +18,9 @@
 #include "wifi_helper.h"
 #include <WiFiManager.h>
 #include <LittleFS.h>
+#include <StreamString.h>
 #include "printer_helper.h"
+#include "gdoor_metrics.h"
 
 /**
  * Overriden WiFiManager class,
@@ -156,6 +158,8 @@ namespace WIFI_HELPER { //Namespace as we can only use it once
     bool shouldSaveConfig = false;
     const char* rx_pin_select_values[] = RX_PIN_CHOICES;    
     const char* rx_sensitivity_select_values[] = RX_SENS_CHOICES;    
+    const char* publish_mode_select_values[] = PUBLISH_MODE_CHOICES;
+    const char* serial_protocol_select_values[] = SERIAL_PROTOCOL_CHOICES;
 
     MyCustomWifiManager wifiManager;
     WiFiManagerParameter custom_mqtt_server("mqtt_server", "MQTT Server", DEFAULT_MQTT_SERVER, 40);
@@ -164,9 +168,22 @@ namespace WIFI_HELPER { //Namespace as we can only use it once
     NullableParameter custom_mqtt_password("mqtt_password", "MQTT Password (optional)", "", 40);
     WiFiManagerParameter custom_mqtt_topic_bus_rx("mqtt_topic_bus_rx", "MQTT Topic - from bus", DEFAULT_MQTT_TOPIC_BUS_RX, 40);
     WiFiManagerParameter custom_mqtt_topic_bus_tx("mqtt_topic_bus_tx", "MQTT Topic - to bus", DEFAULT_MQTT_TOPIC_BUS_TX, 40);
-    EnableDisableParameter custom_debug("param_6", "Debug Mode"); //param_4 is a very ugly workaround for stupid WifiManager custom fields implementation. Works only with param_<fixedno>
-    CheckSelectParameter custom_rx_pin("param_7", "RX Input", rx_pin_select_values, RX_PIN_CHOICES_LEN, 40); 
-    CheckSelectParameter custom_rx_sens("param_8", "IO22 Sensitivity", rx_sensitivity_select_values, RX_SENS_CHOICES_LEN, 40); 
+    WiFiManagerParameter custom_mqtt_topic_diagnostics("mqtt_topic_diagnostics", "MQTT Topic - diagnostics", DEFAULT_MQTT_TOPIC_DIAGNOSTICS, 40);
+    NullableParameter custom_mqtt_topic_devices("mqtt_topic_devices", "MQTT Topic - per device state (optional)", DEFAULT_MQTT_TOPIC_DEVICES, 40);
+    EnableDisableParameter custom_debug("debug", "Debug Mode"); // Select ids are replaced by add_select()
+    CheckSelectParameter custom_rx_pin("rx_pin", "RX Input", rx_pin_select_values, RX_PIN_CHOICES_LEN, 40); 
+    CheckSelectParameter custom_rx_sens("rx_sens", "IO22 Sensitivity", rx_sensitivity_select_values, RX_SENS_CHOICES_LEN, 40); 
+    EnableDisableParameter custom_ha_devices("ha_devices", "Home Assistant entity per bus device");
+    CheckSelectParameter custom_publish_mode("publish_mode", "Publish Mode", publish_mode_select_values, PUBLISH_MODE_CHOICES_LEN, 40);
+    WiFiManagerParameter custom_publish_filter("publish_filter", "Publish filter (optional), e.g. action=BUTTON_RING,DOOR_OPEN source=A286B1", DEFAULT_PUBLISH_FILTER, PUBLISH_FILTER_LEN);
+    NullableParameter custom_udp_target("udp_target", "UDP stream (optional), multicast or unicast, e.g. 239.0.0.71:5071", DEFAULT_UDP_TARGET, 40);
+    NullableParameter custom_udp_tx_sender("udp_tx_sender", "UDP TX (optional), send bus data only from this IP, e.g. 192.168.1.10", DEFAULT_UDP_TX_SENDER, 16);
+    CheckSelectParameter custom_serial_protocol("serial_protocol", "Serial Protocol", serial_protocol_select_values, SERIAL_PROTOCOL_CHOICES_LEN, 40);
+    WiFiManagerParameter custom_serial_baud("serial_baud", "Serial baud rate", DEFAULT_SERIAL_BAUD, 8, "type='number' min=9600 max=3000000");
+    EnableDisableParameter custom_rx_correction("rx_correction", "RX error correction (frames with one parity error)");
+    WiFiManagerParameter custom_dedup_window("dedup_window", "Suppress repeated bus data within ms (0: off)", DEFAULT_DEDUP_WINDOW, 6, "type='number' min=0 max=60000");
+
+    std::vector<std::pair<const char*, std::function<void(WebServer &server)>>> routes; // Additional web server pages
 
     /**
      * Internal function which creates and writes a file to LittleFS.
@@ -196,6 +213,17 @@ namespace WIFI_HELPER { //Namespace as we can only use it once
         return false;
     }
 
+    /**
+     * Internal function which registers a select parameter.
+     * WiFiManager reads custom fields back as param_<index of addParameter call>,
+     * so the form name is derived from the position, not hard coded.
+     * @param parameter Select parameter
+    */
+    void add_select(CheckSelectParameter &parameter) {
+        parameter.myid = "param_" + String(wifiManager.getParametersCount());
+        wifiManager.addParameter(&parameter);
+    }
+
     /**
      * WiFiManager Callback, executed when parameters changed.
     */
@@ -203,6 +231,45 @@ namespace WIFI_HELPER { //Namespace as we can only use it once
         shouldSaveConfig = true;
     }
 
+    /**
+     * Internal function which registers a page at the running web server.
+    */
+    void register_route(const char* uri, std::function<void(WebServer &server)> handler) {
+        wifiManager.server->on(uri, [handler]() {
+            handler(*wifiManager.server);
+        });
+    }
+
+    /**
+     * WiFiManager Callback, executed when its web server is (re)created,
+     * registers the additional pages.
+    */
+    void on_webserver() {
+        for (auto &route : routes) {
+            register_route(route.first, route.second);
+        }
+    }
+
+    /**
+     * Internal WiFi Event callback,
+     * used to count lost WiFi connections.
+    */
+    void on_wifi_disconnected(WiFiEvent_t event, WiFiEventInfo_t info) {
+        GDOOR_METRICS::inc(GDOOR_METRICS::WIFI_DISCONNECTS);
+    }
+
+    /**
+     * Add a page to the web server of the config portal.
+     * @param uri Path of the page, e.g. "/metrics"
+     * @param handler Function which sends the response via the given server
+    */
+    void on(const char* uri, std::function<void(WebServer &server)> handler) {
+        routes.push_back(std::make_pair(uri, handler));
+        if (wifiManager.server) { // Web server already running
+            register_route(uri, handler);
+        }
+    }
+
     /** Returns MQTT broker host*/
     const char* mqtt_server(){
         return custom_mqtt_server.getValue();
@@ -234,6 +301,26 @@ namespace WIFI_HELPER { //Namespace as we can only use it once
         return custom_mqtt_topic_bus_tx.getValue();
     }
 
+    /** Returns MQTT topic where diagnostic data (latency, ...) is send to*/
+    const char* mqtt_topic_diagnostics(){
+        return custom_mqtt_topic_diagnostics.getValue();
+    }
+
+    /** Returns MQTT topic prefix for per device state topics, nullptr if disabled*/
+    const char* mqtt_topic_devices(){
+        return custom_mqtt_topic_devices.getNullableValue();
+    }
+
+    /** Returns true if Home Assistant entities should be created per bus device*/
+    bool ha_device_entities(){
+        return strcmp(custom_ha_devices.getValue(), "enabled") == 0;
+    }
+
+    /** Returns true if bus messages are published as events, without BUS_IDLE reset*/
+    bool event_mode(){
+        return strcmp(custom_publish_mode.getValue(), PUBLISH_MODE_EVENT_NAME) == 0;
+    }
+
     /** Returns true if debug mode is enabled */
     bool debug(){
         return strcmp(custom_debug.getValue(), "enabled") == 0;
@@ -251,10 +338,21 @@ namespace WIFI_HELPER { //Namespace as we can only use it once
             return RX_PIN_12_NUM;
         } else if(!strcmp(value, RX_PIN_32_NAME)) {
             return RX_PIN_32_NUM;
+        } else if(!strcmp(value, RX_PIN_DIVERSITY_NAME)) {
+            return RX_PIN_22_NUM;
         }
         return RX_PIN_22_NUM;
     }
 
+    /** Returns io number of the second RX input in diversity mode, RX_PIN_NONE otherwise*/
+    uint8_t rx_pin_secondary() {
+        if(!strcmp(custom_rx_pin.getValue(), RX_PIN_DIVERSITY_NAME)
+           || (rx_pin() == RX_PIN_22_NUM && rx_sensitivity_auto())) {
+            return RX_PIN_21_NUM;
+        }
+        return RX_PIN_NONE;
+    }
+
     /** Returns DAC value for RX comparator*/
     float rx_sensitivity() {
         const char* value = custom_rx_sens.getValue();
@@ -268,6 +366,62 @@ namespace WIFI_HELPER { //Namespace as we can only use it once
         return RX_SENS_MED_NUM;
     }
 
+    /** Returns true if the RX threshold is calibrated automatically, rx_sensitivity() is the start value then*/
+    bool rx_sensitivity_auto() {
+        return strcmp(custom_rx_sens.getValue(), RX_SENS_AUTO_NAME) == 0;
+    }
+
+    /** Returns true if frames with a single parity error are corrected*/
+    bool rx_correction() {
+        return strcmp(custom_rx_correction.getValue(), "enabled") == 0;
+    }
+
+    /** Returns window (ms) for duplicate suppression, 0 if disabled*/
+    uint16_t dedup_window() {
+        const char* strvalue = custom_dedup_window.getValue();
+        return (uint16_t)atoi(strvalue);
+    }
+
+    /** Returns "<ip>[:<port>]" for the UDP stream, nullptr if disabled*/
+    const char* udp_target() {
+        return custom_udp_target.getNullableValue();
+    }
+
+    /** Returns the IP, which may send bus data via UDP, nullptr if disabled*/
+    const char* udp_tx_sender() {
+        return custom_udp_tx_sender.getNullableValue();
+    }
+
+    /** Returns true if the serial port uses the framed binary protocol, see GDOOR_SERIAL*/
+    bool serial_binary() {
+        return strcmp(custom_serial_protocol.getValue(), SERIAL_PROTOCOL_BINARY_NAME) == 0;
+    }
+
+    /** Returns baud rate of the serial port*/
+    uint32_t serial_baud() {
+        const char* strvalue = custom_serial_baud.getValue();
+        uint32_t baud = strtoul(strvalue, NULL, 10);
+        return baud > 0 ? baud : atoi(DEFAULT_SERIAL_BAUD);
+    }
+
+    /** Returns the publish filter, see GDOOR_FILTER*/
+    const char* publish_filter() {
+        return custom_publish_filter.getValue();
+    }
+
+    /**
+     * Changes and stores the publish filter,
+     * without restart as it is applied at runtime.
+     * @param filter publish filter, see GDOOR_FILTER
+    */
+    void save_publish_filter(const char* filter) {
+        custom_publish_filter.setValue(filter, PUBLISH_FILTER_LEN);
+        if (LittleFS.begin(true)) {
+            save_config_file("/custom_publish_filter", custom_publish_filter.getValue());
+            LittleFS.end();
+        }
+    }
+
     void setup() {
         String filevalue;
 
@@ -297,6 +451,14 @@ namespace WIFI_HELPER { //Namespace as we can only use it once
                 custom_mqtt_topic_bus_tx.setValue(filevalue.c_str(), 20);
             }
 
+            if (read_config_file("/custom_mqtt_topic_diagnostics", &filevalue) && filevalue.length() > 0) {
+                custom_mqtt_topic_diagnostics.setValue(filevalue.c_str(), 40);
+            }
+
+            if (read_config_file("/custom_mqtt_topic_devices", &filevalue)) {
+                custom_mqtt_topic_devices.setValue(filevalue.c_str(), 40);
+            }
+
             if (read_config_file("/custom_debug", &filevalue) && filevalue.length() > 0 ) {
                 custom_debug.setValue(filevalue.c_str(), 10);
             }
@@ -309,6 +471,42 @@ namespace WIFI_HELPER { //Namespace as we can only use it once
                 custom_rx_sens.setValue(filevalue.c_str(), 40);
             }
 
+            if (read_config_file("/custom_ha_devices", &filevalue) && filevalue.length() > 0 ) {
+                custom_ha_devices.setValue(filevalue.c_str(), 10);
+            }
+
+            if (read_config_file("/custom_dedup_window", &filevalue) && filevalue.length() > 0 ) {
+                custom_dedup_window.setValue(filevalue.c_str(), 6);
+            }
+
+            if (read_config_file("/custom_publish_mode", &filevalue) && filevalue.length() > 0 ) {
+                custom_publish_mode.setValue(filevalue.c_str(), 40);
+            }
+
+            if (read_config_file("/custom_publish_filter", &filevalue)) {
+                custom_publish_filter.setValue(filevalue.c_str(), PUBLISH_FILTER_LEN);
+            }
+
+            if (read_config_file("/custom_udp_target", &filevalue)) {
+                custom_udp_target.setValue(filevalue.c_str(), 40);
+            }
+
+            if (read_config_file("/custom_udp_tx_sender", &filevalue)) {
+                custom_udp_tx_sender.setValue(filevalue.c_str(), 16);
+            }
+
+            if (read_config_file("/custom_serial_protocol", &filevalue) && filevalue.length() > 0 ) {
+                custom_serial_protocol.setValue(filevalue.c_str(), 40);
+            }
+
+            if (read_config_file("/custom_serial_baud", &filevalue) && filevalue.length() > 0 ) {
+                custom_serial_baud.setValue(filevalue.c_str(), 8);
+            }
+
+            if (read_config_file("/custom_rx_correction", &filevalue) && filevalue.length() > 0 ) {
+                custom_rx_correction.setValue(filevalue.c_str(), 10);
+            }
+
             LittleFS.end();
         } else {
             JSONPRINT("Could not mount filesystem on load");
@@ -326,13 +524,33 @@ namespace WIFI_HELPER { //Namespace as we can only use it once
         wifiManager.addParameter(&custom_mqtt_topic_bus_rx);
         wifiManager.addParameter(&custom_mqtt_topic_bus_tx);
         
-        wifiManager.addParameter(&custom_debug);
-
-        wifiManager.addParameter(&custom_rx_pin);
-        wifiManager.addParameter(&custom_rx_sens);
+        add_select(custom_debug);
+
+        add_select(custom_rx_pin);
+        add_select(custom_rx_sens);
+
+        wifiManager.addParameter(&custom_mqtt_topic_diagnostics);
+        wifiManager.addParameter(&custom_mqtt_topic_devices);
+        add_select(custom_ha_devices);
+        wifiManager.addParameter(&custom_dedup_window);
+        add_select(custom_publish_mode);
+        wifiManager.addParameter(&custom_publish_filter);
+        wifiManager.addParameter(&custom_udp_target);
+        wifiManager.addParameter(&custom_udp_tx_sender);
+        add_select(custom_serial_protocol);
+        wifiManager.addParameter(&custom_serial_baud);
+        add_select(custom_rx_correction);
 
         wifiManager.setSaveConfigCallback(on_save);
         wifiManager.setSaveParamsCallback(on_save);
+        wifiManager.setWebServerCallback(on_webserver);
+
+        on("/metrics", [](WebServer &server) {
+            StreamString response;
+            GDOOR_METRICS::printPrometheus(response);
+            server.send(200, "text/plain; version=0.0.4", response);
+        });
+        WiFi.onEvent(on_wifi_disconnected, WiFiEvent_t::ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
 
         wifiManager.setHostname("GDoor");
         wifiManager.setShowPassword(true);
@@ -342,7 +560,7 @@ namespace WIFI_HELPER { //Namespace as we can only use it once
         wifiManager.setTimeout(300);
         std::vector<const char *> menu = {"wifi","param","sep","update"};
         wifiManager.setMenu(menu);
-        wifiManager.setDebugOutput(debug());
+        wifiManager.setDebugOutput(debug() && !serial_binary()); // Would corrupt the framed serial protocol
         wifiManager.autoConnect(DEFAULT_WIFI_SSID, DEFAULT_WIFI_PASSWORD);
         wifiManager.startWebPortal();
     }
@@ -360,9 +578,20 @@ namespace WIFI_HELPER { //Namespace as we can only use it once
                 save_config_file("/custom_mqtt_password", custom_mqtt_password.getValue());
                 save_config_file("/custom_mqtt_topic_bus_rx", custom_mqtt_topic_bus_rx.getValue());
                 save_config_file("/custom_mqtt_topic_bus_tx", custom_mqtt_topic_bus_tx.getValue());
+                save_config_file("/custom_mqtt_topic_diagnostics", custom_mqtt_topic_diagnostics.getValue());
+                save_config_file("/custom_mqtt_topic_devices", custom_mqtt_topic_devices.getValue());
                 save_config_file("/custom_debug", custom_debug.getValue());
                 save_config_file("/custom_rx_pin", custom_rx_pin.getValue());
                 save_config_file("/custom_rx_sens", custom_rx_sens.getValue());
+                save_config_file("/custom_ha_devices", custom_ha_devices.getValue());
+                save_config_file("/custom_dedup_window", custom_dedup_window.getValue());
+                save_config_file("/custom_publish_mode", custom_publish_mode.getValue());
+                save_config_file("/custom_publish_filter", custom_publish_filter.getValue());
+                save_config_file("/custom_udp_target", custom_udp_target.getValue());
+                save_config_file("/custom_udp_tx_sender", custom_udp_tx_sender.getValue());
+                save_config_file("/custom_serial_protocol", custom_serial_protocol.getValue());
+                save_config_file("/custom_serial_baud", custom_serial_baud.getValue());
+                save_config_file("/custom_rx_correction", custom_rx_correction.getValue());
                 LittleFS.end();
                 ESP.restart();
             } else {
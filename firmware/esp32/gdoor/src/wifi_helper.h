@@ -18,6 +18,7 @@
 #ifndef WIFI_H
 #define WIFI_H
 #include <Arduino.h>
+#include <WebServer.h>
 
 namespace WIFI_HELPER { //Namespace as we can only use it once
     void loop();
@@ -28,9 +29,24 @@ namespace WIFI_HELPER { //Namespace as we can only use it once
     const char* mqtt_password();
     const char* mqtt_topic_bus_rx();
     const char* mqtt_topic_bus_tx();
+    const char* mqtt_topic_diagnostics();
+    const char* mqtt_topic_devices();
+    bool ha_device_entities();
+    bool event_mode();
     bool debug();
     uint8_t rx_pin();
+    uint8_t rx_pin_secondary();
     float rx_sensitivity();
+    bool rx_sensitivity_auto();
+    bool rx_correction();
+    uint16_t dedup_window();
+    const char* publish_filter();
+    const char* udp_target();
+    const char* udp_tx_sender();
+    bool serial_binary();
+    uint32_t serial_baud();
+    void save_publish_filter(const char* filter);
+    void on(const char* uri, std::function<void(WebServer &server)> handler);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,74 @@
+import argparse
+import socket
+import struct
+import time
+
+# Binary format of the GDoor UDP stream, see firmware/esp32/gdoor/src/gdoor_sinks.h
+HEADER = struct.Struct("<2sBBIIBB")
+VERSION = 1
+TYPE_FRAME = 0x01
+TYPE_TX = 0x02
+FLAG_VALID = 0x01
+
+parser = argparse.ArgumentParser(description='Listen to the GDoor UDP stream, or send bus data to it')
+parser.add_argument('-g','--group', help='Multicast group, empty for unicast', default="239.0.0.71")
+parser.add_argument('-p','--port', help='UDP Port', default=5071, type=int)
+parser.add_argument('-a','--adapter', help='Adapter IP, needed to send via unicast', default=None)
+parser.add_argument('-s','--send', help='Send hex bus data (without checksum) and exit', default=None)
+parser.add_argument('-c','--count', help='Exit after n frames and print statistics (benchmark)', default=0, type=int)
+args = parser.parse_args()
+
+def open_socket():
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    sock.bind(("", args.port))
+    if args.group:
+        mreq = struct.pack("4sl", socket.inet_aton(args.group), socket.INADDR_ANY)
+        sock.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, mreq)
+    return sock
+
+def send(data):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, 1)
+    datagram = HEADER.pack(b"GD", VERSION, TYPE_TX, 0, 0, 0, len(data)) + data
+    sock.sendto(datagram, (args.adapter or args.group, args.port))
+
+def listen():
+    sock = open_socket()
+    last_sequence = None
+    frames = 0
+    lost = 0
+    restarts = 0
+    start = None
+    while args.count == 0 or frames < args.count:
+        datagram, sender = sock.recvfrom(512)
+        if len(datagram) < HEADER.size:
+            continue
+        magic, version, type, sequence, timestamp, flags, length = HEADER.unpack_from(datagram)
+        if magic != b"GD" or version != VERSION or type != TYPE_FRAME:
+            continue
+        data = datagram[HEADER.size:HEADER.size+length]
+
+        if last_sequence is not None:
+            gap = (sequence - last_sequence - 1) & 0xFFFFFFFF
+            # A jump back, or a new start at 0/1 which is no wrap around, is a restart of the adapter
+            if gap >= 0x80000000 or (sequence <= 1 and gap != 0):
+                restarts += 1
+                print("Adapter restarted, sequence %d -> %d" % (last_sequence, sequence))
+            else:
+                lost += gap
+        last_sequence = sequence
+        frames += 1
+        if start is None:
+            start = time.monotonic()
+
+        print("%s #%d t=%dus %s %s" % (sender[0], sequence, timestamp,
+            "valid  " if flags & FLAG_VALID else "invalid", data.hex().upper()))
+
+    duration = time.monotonic() - start
+    print("frames: %d, lost: %d, restarts: %d, duration: %.1fs, rate: %.1f frames/s" % (frames, lost, restarts, duration, frames/duration if duration > 0 else 0))
+
+if args.send:
+    send(bytes.fromhex(args.send))
+else:
+    listen()
@@ -0,0 +1,66 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+* Converts a GDoor capture file to debug json lines,
+* as printed by the adapter in debug mode (busdata, raw, valid),
+* plus the capture timestamp. Bitstreams are decoded by the decoder of the adapter.
+* Usage: capture2json [-c] <capture file>
+*   -c: soft-decision correction of single parity errors, as with RX correction enabled
+*/
+#include <cstdio>
+#include <cstring>
+#include "gdoor_capture.h"
+
+int main(int argc, char **argv) {
+    bool correction = argc == 3 && strcmp(argv[1], "-c") == 0;
+    if (argc != 2 && !correction) {
+        fprintf(stderr, "Usage: %s [-c] <capture file>\n", argv[0]);
+        return 1;
+    }
+    try {
+        GDOOR_CAPTURE::reader capture(argv[argc-1]);
+        GDOOR_CAPTURE::bitstream b;
+        GDOOR_CAPTURE::frame f;
+        while (capture.next(b)) {
+            if (!GDOOR_CAPTURE::decode(b.counts, f, correction)) {
+                f.data.clear();
+                f.valid = false;
+                f.corrected = false;
+            }
+            printf("{\"busdata\": \"");
+            for (uint8_t byte : f.data) {
+                printf("%02X", byte);
+            }
+            printf("\", \"raw\": [");
+            for (size_t i=0; i<b.counts.size(); i++) {
+                printf("%s\"0x%X\"", i == 0 ? "" : ", ", b.counts[i]);
+            }
+            printf("], \"valid\": %s, \"timestamp_us\": \"%u\"", f.valid ? "true" : "false", b.timestamp_us);
+            if (f.corrected) {
+                printf(", \"corrected\": true");
+            }
+            if (b.flags & GDOOR_CAPTURE::FLAG_SECONDARY) { // Second copy of the previous bitstream
+                printf(", \"secondary\": true");
+            }
+            printf("}\n");
+        }
+    } catch (const std::exception &e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
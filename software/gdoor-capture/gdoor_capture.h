@@ -0,0 +1,255 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GDOOR_CAPTURE_H
+#define GDOOR_CAPTURE_H
+/*
+* Host side reader/writer for GDoor capture files, see README.md.
+* Header only, C++17, Linux (mmap).
+*/
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "gdoor_decoder.h"
+
+namespace GDOOR_CAPTURE {
+    const char MAGIC[8] = {'G', 'D', 'O', 'O', 'R', 'C', 'A', 'P'};
+    const uint16_t VERSION = 1;
+    const uint16_t HEADER_LEN = 32;
+    const uint16_t RECORD_HEADER_LEN = 12;
+    const uint16_t RECORD_BITSTREAM = 1;
+    const uint16_t FLAG_PARSED = 0x01;
+    const uint16_t FLAG_VALID = 0x02;
+    const uint16_t FLAG_SECONDARY = 0x04; // Secondary RX input (diversity mode)
+
+    struct header {
+        uint8_t adapter_id[6]; // WiFi MAC of the adapter
+        uint8_t rx_pin;
+        float rx_sensitivity; // RX comparator threshold (V)
+        uint32_t carrier_freq; // Hz, pulse counts are carrier edges per bit
+        uint32_t start_time; // Unix time (s) of capture start, 0 if unknown
+    };
+
+    struct bitstream {
+        uint32_t timestamp_us; // Adapter micros() of first edge
+        uint16_t flags; // FLAG_*
+        std::vector<uint16_t> counts; // Pulse counts, as seen before parsing
+    };
+
+    struct frame { // Result of decode()
+        std::vector<uint8_t> data; // Bus data, last byte is the checksum
+        bool valid;
+        bool corrected; // Made valid by the soft-decision correction
+    };
+
+    inline uint16_t get16(const uint8_t *p) {
+        return p[0] | (p[1] << 8);
+    }
+
+    inline uint32_t get32(const uint8_t *p) {
+        return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    inline void put16(std::string &s, uint16_t value) {
+        s.push_back(value & 0xFF);
+        s.push_back(value >> 8);
+    }
+
+    inline void put32(std::string &s, uint32_t value) {
+        put16(s, value & 0xFFFF);
+        put16(s, value >> 16);
+    }
+
+    /*
+    * Parses the file header.
+    * @param data start of the capture
+    * @param len available bytes
+    * @return header, throws std::runtime_error if not a capture
+    */
+    inline header parse_header(const uint8_t *data, size_t len) {
+        if (len < HEADER_LEN || memcmp(data, MAGIC, 8) != 0) {
+            throw std::runtime_error("not a GDoor capture");
+        }
+        if (get16(&data[8]) != VERSION) {
+            throw std::runtime_error("unsupported capture version");
+        }
+        header h;
+        memcpy(h.adapter_id, &data[12], 6);
+        h.rx_pin = data[18];
+        uint32_t sensitivity = get32(&data[20]);
+        memcpy(&h.rx_sensitivity, &sensitivity, 4);
+        h.carrier_freq = get32(&data[24]);
+        h.start_time = get32(&data[28]);
+        return h;
+    }
+
+    /*
+    * Memory mapped capture file, records are read without copying the file.
+    * A capture which is still written (truncated last record) is read up to
+    * the last complete record.
+    */
+    class reader {
+        public:
+            header file_header;
+
+            reader(const std::string &filename) {
+                fd = open(filename.c_str(), O_RDONLY);
+                if (fd < 0) {
+                    throw std::runtime_error("cannot open " + filename);
+                }
+                struct stat st;
+                fstat(fd, &st);
+                size = st.st_size;
+                if (size > 0) {
+                    map = (const uint8_t*)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+                    if (map == MAP_FAILED) {
+                        close(fd);
+                        throw std::runtime_error("cannot map " + filename);
+                    }
+                }
+                try {
+                    file_header = parse_header(map, size);
+                } catch (...) {
+                    release();
+                    throw;
+                }
+                offset = get16(&map[10]);
+            }
+
+            ~reader() {
+                release();
+            }
+
+            reader(const reader&) = delete;
+            reader& operator=(const reader&) = delete;
+
+            /*
+            * Reads the next bitstream record, unknown record types are skipped.
+            * @return false at end of file
+            */
+            bool next(bitstream &b) {
+                while (offset + RECORD_HEADER_LEN <= size) {
+                    const uint8_t *r = &map[offset];
+                    uint16_t type = get16(&r[0]);
+                    uint16_t len = get16(&r[2]);
+                    if (len < RECORD_HEADER_LEN || offset + len > size) {
+                        return false;
+                    }
+                    offset += len;
+                    if (type != RECORD_BITSTREAM) {
+                        continue;
+                    }
+                    uint16_t count = get16(&r[8]);
+                    if (RECORD_HEADER_LEN + count*2 > len) {
+                        return false;
+                    }
+                    b.timestamp_us = get32(&r[4]);
+                    b.flags = get16(&r[10]);
+                    b.counts.resize(count);
+                    for (uint16_t i=0; i<count; i++) {
+                        b.counts[i] = get16(&r[RECORD_HEADER_LEN + 2*i]);
+                    }
+                    return true;
+                }
+                return false;
+            }
+
+        private:
+            void release() {
+                if (map != NULL && map != MAP_FAILED) {
+                    munmap((void*)map, size);
+                    map = NULL;
+                }
+                if (fd >= 0) {
+                    close(fd);
+                    fd = -1;
+                }
+            }
+
+            int fd = -1;
+            const uint8_t *map = NULL;
+            size_t size = 0;
+            size_t offset = 0;
+    };
+
+    /*
+    * Serializes the file header.
+    */
+    inline std::string serialize(const header &h) {
+        std::string s(MAGIC, 8);
+        put16(s, VERSION);
+        put16(s, HEADER_LEN);
+        s.append((const char*)h.adapter_id, 6);
+        s.push_back(h.rx_pin);
+        s.push_back(0);
+        uint32_t sensitivity;
+        memcpy(&sensitivity, &h.rx_sensitivity, 4);
+        put32(s, sensitivity);
+        put32(s, h.carrier_freq);
+        put32(s, h.start_time);
+        return s;
+    }
+
+    /*
+    * Serializes a bitstream record, padded to a multiple of 4 bytes.
+    */
+    inline std::string serialize(const bitstream &b) {
+        uint16_t len = (RECORD_HEADER_LEN + b.counts.size()*2 + 3) & ~3;
+        std::string s;
+        put16(s, RECORD_BITSTREAM);
+        put16(s, len);
+        put32(s, b.timestamp_us);
+        put16(s, b.counts.size());
+        put16(s, b.flags);
+        for (uint16_t count : b.counts) {
+            put16(s, count);
+        }
+        s.resize(len, '\0');
+        return s;
+    }
+
+    /*
+    * Decodes pulse counts with the decoder of the adapter (GDOOR_FRAME::parse,
+    * firmware/esp32/gdoor/src/gdoor_decoder.h), so decoder changes can be tried
+    * on recorded bitstreams. As on the adapter, counts beyond the RX buffer are dropped.
+    * @param counts pulse counts of one bitstream
+    * @param f returns the decoded frame
+    * @param correction try GDOOR_FRAME::correct on a single parity error
+    * @return false if no word could be decoded
+    */
+    inline bool decode(const std::vector<uint16_t> &counts, frame &f, bool correction = false) {
+        static GDOOR_FRAME decoded;
+        uint16_t len = counts.size() < GDOOR_CONFIG::max_wordlen*9 ? counts.size() : GDOOR_CONFIG::max_wordlen*9;
+        if (!decoded.parse<GDOOR_CONFIG>(counts.data(), len)) {
+            return false;
+        }
+        if (correction) {
+            decoded.correct<GDOOR_CONFIG>();
+        }
+        f.data.assign(decoded.data, decoded.data + decoded.len);
+        f.valid = decoded.valid;
+        f.corrected = decoded.corrected;
+        return true;
+    }
+}
+
+#endif
@@ -0,0 +1,81 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+* Converts debug json lines (serial log or MQTT dump of an adapter in debug mode)
+* to a GDoor capture file. Every line with a "raw" array becomes one bitstream record.
+* Note: the adapter prints len*9 pulse counts only, filtered glitches
+* and counts after the last word are not part of the debug json.
+* Usage: json2capture <capture file> [rx pin] [rx sensitivity] < debug.log
+*/
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include "gdoor_capture.h"
+
+/*
+* Returns the value of "key": "value" or "key": value in a json line, empty if missing.
+*/
+std::string json_value(const std::string &line, const std::string &key) {
+    size_t pos = line.find("\"" + key + "\"");
+    if (pos == std::string::npos || (pos = line.find(':', pos)) == std::string::npos) {
+        return "";
+    }
+    pos = line.find_first_not_of(" \"", pos + 1);
+    size_t end = line.find_first_of("\",}", pos);
+    return pos == std::string::npos ? "" : line.substr(pos, end - pos);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <capture file> [rx pin] [rx sensitivity] < debug.log\n", argv[0]);
+        return 1;
+    }
+    FILE *out = fopen(argv[1], "wb");
+    if (out == NULL) {
+        fprintf(stderr, "cannot open %s\n", argv[1]);
+        return 1;
+    }
+
+    GDOOR_CAPTURE::header h = {};
+    h.rx_pin = argc > 2 ? atoi(argv[2]) : 0;
+    h.rx_sensitivity = argc > 3 ? atof(argv[3]) : 0;
+    h.carrier_freq = GDOOR_CONFIG::tx_pulse_freq;
+    std::string s = GDOOR_CAPTURE::serialize(h);
+    fwrite(s.data(), 1, s.size(), out);
+
+    std::string line;
+    size_t records = 0;
+    while (std::getline(std::cin, line)) {
+        size_t start = line.find("\"raw\"");
+        if (start == std::string::npos || (start = line.find('[', start)) == std::string::npos) {
+            continue;
+        }
+        size_t end = line.find(']', start);
+        GDOOR_CAPTURE::bitstream b;
+        b.timestamp_us = strtoul(json_value(line, "timestamp_us").c_str(), NULL, 10);
+        b.flags = GDOOR_CAPTURE::FLAG_PARSED | (json_value(line, "valid") == "true" ? GDOOR_CAPTURE::FLAG_VALID : 0);
+        for (size_t pos = line.find("0x", start); pos != std::string::npos && pos < end; pos = line.find("0x", pos + 2)) {
+            b.counts.push_back(strtoul(line.c_str() + pos, NULL, 16));
+        }
+        s = GDOOR_CAPTURE::serialize(b);
+        fwrite(s.data(), 1, s.size(), out);
+        records++;
+    }
+    fclose(out);
+    fprintf(stderr, "%zu records\n", records);
+    return 0;
+}
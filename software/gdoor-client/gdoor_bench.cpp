@@ -0,0 +1,180 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+* Throughput benchmark of the parsers, with recorded streams
+* (serial port in json or binary mode, MQTT dump) or synthetic data.
+*/
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <vector>
+#include "gdoor_client.h"
+
+using namespace GDOOR_CLIENT;
+
+struct result {
+    uint64_t frames = 0;
+    uint64_t checksum = 0; // Uses the parsed fields, so nothing is optimized away
+};
+
+/*
+* Feeds the stream in chunks, as read from a port, until at least one second passed.
+*/
+template<typename DECODER> void bench(const char *name, const std::string &stream, DECODER &decoder, result &r) {
+    const size_t chunk = 4096;
+    uint64_t passes = 0;
+    auto start = std::chrono::steady_clock::now();
+    double seconds = 0;
+    do {
+        for (size_t offset = 0; offset < stream.size(); offset += chunk) {
+            decoder.feed((const uint8_t*)stream.data() + offset, std::min(chunk, stream.size() - offset));
+        }
+        passes++;
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (seconds < 1.0);
+    printf("%-24s %10.1f MB/s %12.0f frames/s  (%llu frames per pass, checksum %llx)\n", name,
+        stream.size() * passes / seconds / 1e6, r.frames / seconds,
+        (unsigned long long)(r.frames / passes), (unsigned long long)r.checksum);
+}
+
+template<typename DECODER> void connect(DECODER &decoder, result &r) {
+    decoder.on_frame = [&r](const frame &f) {
+        r.frames++;
+        if (f.has_protocol()) {
+            r.checksum += (uint8_t)f.action() + f.source() + f.parameters();
+        }
+    };
+}
+
+void bench_serial(const char *name, const std::string &stream) {
+    result check;
+    serial_decoder first_pass;
+    connect(first_pass, check);
+    first_pass.feed((const uint8_t*)stream.data(), stream.size());
+
+    result r;
+    serial_decoder decoder;
+    connect(decoder, r);
+    bench(name, stream, decoder, r);
+    printf("%-24s %llu errors, %llu lost messages\n", "",
+        (unsigned long long)first_pass.errors, (unsigned long long)first_pass.lost);
+}
+
+void bench_json(const char *name, const std::string &stream) {
+    result r;
+    line_decoder decoder;
+    connect(decoder, r);
+    bench(name, stream, decoder, r);
+}
+
+/*
+* Creates random bus frames with checksum, like GDOOR_TX.
+*/
+std::vector<std::vector<uint8_t>> synthetic_frames(size_t count) {
+    std::mt19937 rng(42);
+    const action actions[] = {action::BUTTON_RING, action::DOOR_OPEN, action::CTRL_DOOROPENER_ACK, action::BUTTON_LIGHT};
+    std::vector<std::vector<uint8_t>> frames;
+    for (size_t i=0; i<count; i++) {
+        uint8_t data[MAX_WORDLEN];
+        size_t len = encode(data, actions[rng() % 4], hwtype::INDOOR, rng() & 0xFFFFFF, rng() & 0xFFFF, (i % 2) ? rng() & 0xFFFFFF : 0);
+        uint8_t crc = 0;
+        for (size_t j=0; j<len; j++) {
+            crc += data[j];
+        }
+        data[len++] = crc;
+        frames.emplace_back(data, data + len);
+    }
+    return frames;
+}
+
+/*
+* Serial stream in binary mode, as sent by the adapter.
+*/
+std::string synthetic_serial(const std::vector<std::vector<uint8_t>> &frames) {
+    std::string stream;
+    uint32_t sequence = 0;
+    for (auto &data : frames) {
+        uint8_t binary[BINARY_HEADER_LEN] = {'G', 'D', BINARY_VERSION, BINARY_TYPE_FRAME};
+        put32(&binary[4], ++sequence);
+        put32(&binary[8], sequence * 100000);
+        binary[12] = BINARY_FLAG_VALID;
+        binary[13] = data.size();
+        std::string payload((const char*)binary, BINARY_HEADER_LEN);
+        payload.append((const char*)data.data(), data.size());
+        stream += serial_message(SERIAL_MSG_FRAME, sequence, (const uint8_t*)payload.data(), payload.size());
+    }
+    return stream;
+}
+
+/*
+* Serial stream in json mode, as printed by the adapter.
+*/
+std::string synthetic_json(const std::vector<std::vector<uint8_t>> &frames) {
+    std::ostringstream stream;
+    uint32_t event_id = 0;
+    for (auto &data : frames) {
+        frame f;
+        f.data = data.data();
+        f.len = data.size();
+        char source[8];
+        char destination[8];
+        char parameters[8];
+        snprintf(source, sizeof(source), "%06X", f.source());
+        snprintf(destination, sizeof(destination), "%06X", f.destination());
+        snprintf(parameters, sizeof(parameters), "%04X", f.parameters());
+        stream << "{\"action\": \"" << f.action_name() << "\", \"parameters\": \"" << parameters
+            << "\", \"source\": \"" << source << "\", \"destination\": \"" << destination
+            << "\", \"type\": \"" << f.type_name() << "\", \"busdata\": \"" << hexstring(data.data(), data.size())
+            << "\", \"event_id\": \"" << event_id++ << "\"}\r\n";
+        stream << "{\"action\": \"BUS_IDLE\", \"parameters\": \"0000\", \"source\": \"000000\", \"destination\": \"000000\", "
+            << "\"type\": \"TYPE_GDOOR\", \"event_id\": \"" << event_id++ << "\"}\r\n";
+    }
+    return stream.str();
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && argv[1][0] == '-') {
+        fprintf(stderr, "Usage: %s [stream ...]\n"
+            "  stream: recorded serial port (json or binary mode) or MQTT dump (json lines),\n"
+            "  without streams synthetic data is used\n", argv[0]);
+        return 1;
+    }
+    if (argc == 1) {
+        auto frames = synthetic_frames(100000);
+        bench_serial("synthetic serial binary", synthetic_serial(frames));
+        bench_json("synthetic json lines", synthetic_json(frames));
+        return 0;
+    }
+    for (int i=1; i<argc; i++) {
+        std::ifstream file(argv[i], std::ios::binary);
+        if (!file) {
+            fprintf(stderr, "Cannot open %s\n", argv[i]);
+            return 1;
+        }
+        std::stringstream content;
+        content << file.rdbuf();
+        std::string stream = content.str();
+        if (stream.find('{') != std::string::npos && stream.find('\0') == std::string::npos) {
+            bench_json(argv[i], stream);
+        } else {
+            bench_serial(argv[i], stream);
+        }
+    }
+    return 0;
+}
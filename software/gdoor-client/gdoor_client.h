@@ -0,0 +1,449 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GDOOR_CLIENT_H
+#define GDOOR_CLIENT_H
+/*
+* Host side parsers and encoders for the output formats of the GDoor adapter,
+* see README.md. Header only, C++17, no dependencies.
+*
+* Parsed frames point into the parsed buffer (binary formats) or into the
+* parser (json), they are valid until the next call of the parser.
+*/
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <functional>
+#include "gdoor_protocol.h" // firmware/esp32/gdoor/src
+#include "gdoor_formats.h" // firmware/esp32/gdoor/src, BINARY_*, SERIAL_MSG_*, SERIAL_ACK_*
+
+namespace GDOOR_CLIENT {
+    const uint8_t MAX_WORDLEN = 25; // As in firmware/esp32/gdoor/src/defines.h
+
+    const size_t MESSAGE_MAX = 4096 + SERIAL_FRAMING_LEN; // Longest adapter message, json diagnostics
+
+    #define GDOOR_CLIENT_ENUM_ENTRY(value, name) name = value,
+    enum class hwtype : uint8_t {
+        GDOOR_PROTOCOL_HWTYPES(GDOOR_CLIENT_ENUM_ENTRY)
+    };
+    enum class action : uint8_t {
+        GDOOR_PROTOCOL_ACTIONS(GDOOR_CLIENT_ENUM_ENTRY)
+    };
+    #undef GDOOR_CLIENT_ENUM_ENTRY
+
+    /*
+    * Internal, bus value to name lookup table, NULL for unknown values.
+    */
+    struct name_table {
+        const char *names[256] = {NULL};
+
+        name_table(bool actions) {
+            #define GDOOR_CLIENT_NAME_ENTRY(value, name) names[value] = #name;
+            if (actions) {
+                GDOOR_PROTOCOL_ACTIONS(GDOOR_CLIENT_NAME_ENTRY)
+            } else {
+                GDOOR_PROTOCOL_HWTYPES(GDOOR_CLIENT_NAME_ENTRY)
+            }
+            #undef GDOOR_CLIENT_NAME_ENTRY
+        }
+    };
+
+    /* Returns name of an action as in the json output, "ACTION_UNKOWN" if unknown (sic, as firmware) */
+    inline const char *action_name(uint8_t value) {
+        static const name_table table(true);
+        return table.names[value] ? table.names[value] : "ACTION_UNKOWN";
+    }
+
+    /* Returns name of a HW type as in the json output, "TYPE_UNKOWN" if unknown (sic, as firmware) */
+    inline const char *hwtype_name(uint8_t value) {
+        static const name_table table(false);
+        return table.names[value] ? table.names[value] : "TYPE_UNKOWN";
+    }
+
+    /*
+    * Received bus frame, fields as GDOOR_DATA_PROTOCOL of the firmware.
+    * Protocol fields are only meaningful if has_protocol() is true.
+    */
+    struct frame {
+        const uint8_t *data = NULL; // Bus data, last byte is the checksum
+        uint8_t len = 0;
+        bool valid = false; // Parity and checksum ok (json: checksum only)
+        uint32_t sequence = 0; // Binary formats, counts every frame, gaps are lost frames
+        uint32_t timestamp_us = 0; // Binary formats, adapter micros() of first edge
+
+        bool has_protocol() const { return valid && len >= 9; }
+        enum action action() const { return (enum action)data[2]; }
+        hwtype type() const { return (hwtype)data[8]; }
+        const char *action_name() const { return GDOOR_CLIENT::action_name(data[2]); }
+        const char *type_name() const { return GDOOR_CLIENT::hwtype_name(data[8]); }
+        uint32_t source() const { return (data[3] << 16) | (data[4] << 8) | data[5]; }
+        uint32_t destination() const { return len >= 12 ? (data[9] << 16) | (data[10] << 8) | data[11] : 0; }
+        uint16_t parameters() const { return (data[6] << 8) | data[7]; }
+    };
+
+    inline uint32_t get32(const uint8_t *p) {
+        return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    inline void put32(uint8_t *p, uint32_t value) {
+        for (uint8_t i=0; i<4; i++) {
+            p[i] = value >> (8*i);
+        }
+    }
+
+    /*
+    * Parses a binary frame (UDP datagram or SERIAL_MSG_FRAME payload), without copying.
+    * @return false if buffer is no received bus frame
+    */
+    inline bool parse_binary(const uint8_t *buffer, size_t len, frame &f) {
+        if (len < BINARY_HEADER_LEN || buffer[BINARY_OFFSET_MAGIC] != 'G' || buffer[BINARY_OFFSET_MAGIC+1] != 'D'
+            || buffer[BINARY_OFFSET_VERSION] != BINARY_VERSION || buffer[BINARY_OFFSET_TYPE] != BINARY_TYPE_FRAME
+            || buffer[BINARY_OFFSET_LEN] == 0 || buffer[BINARY_OFFSET_LEN] > MAX_WORDLEN
+            || len < (size_t)BINARY_HEADER_LEN + buffer[BINARY_OFFSET_LEN]) {
+            return false;
+        }
+        f.sequence = get32(&buffer[BINARY_OFFSET_SEQUENCE]);
+        f.timestamp_us = get32(&buffer[BINARY_OFFSET_TIMESTAMP]);
+        f.valid = buffer[BINARY_OFFSET_FLAGS] & BINARY_FLAG_VALID;
+        f.len = buffer[BINARY_OFFSET_LEN];
+        f.data = &buffer[BINARY_HEADER_LEN];
+        return true;
+    }
+
+    /*
+    * Creates a binary TX datagram for the UDP stream.
+    * @param data bus data without checksum, 1 to MAX_WORDLEN-1 bytes
+    */
+    inline std::string binary_tx(const uint8_t *data, size_t len) {
+        uint8_t header[BINARY_HEADER_LEN] = {'G', 'D', BINARY_VERSION, BINARY_TYPE_TX};
+        header[BINARY_OFFSET_LEN] = len;
+        std::string s((const char*)header, BINARY_HEADER_LEN);
+        s.append((const char*)data, len);
+        return s;
+    }
+
+    inline int hexvalue(char c) {
+        if (c >= '0' && c <= '9') {
+            return c - '0';
+        } else if (c >= 'A' && c <= 'F') {
+            return c - 'A' + 10;
+        } else if (c >= 'a' && c <= 'f') {
+            return c - 'a' + 10;
+        }
+        return -1;
+    }
+
+    /*
+    * Returns data as upper case hex string, as accepted by the adapter
+    * on serial (json mode) and the MQTT bus_tx topic.
+    */
+    inline std::string hexstring(const uint8_t *data, size_t len) {
+        const char hexchars[] = "0123456789ABCDEF";
+        std::string s;
+        s.reserve(len*2);
+        for (size_t i=0; i<len; i++) {
+            s += hexchars[data[i] >> 4];
+            s += hexchars[data[i] & 0x0F];
+        }
+        return s;
+    }
+
+    /*
+    * Creates bus data with GDOOR_PROTOCOL::pack, as GDOOR_DATA_PROTOCOL::encode of the firmware.
+    * The checksum is added by the adapter.
+    * @param data output buffer, at least 12 bytes
+    * @param destination 0: 9 byte frame without destination
+    * @return number of bytes
+    */
+    inline size_t encode(uint8_t *data, action a, hwtype type, uint32_t source, uint16_t parameters, uint32_t destination = 0) {
+        const uint8_t source_bytes[3] = {(uint8_t)(source >> 16), (uint8_t)(source >> 8), (uint8_t)source};
+        const uint8_t parameter_bytes[2] = {(uint8_t)(parameters >> 8), (uint8_t)parameters};
+        const uint8_t destination_bytes[3] = {(uint8_t)(destination >> 16), (uint8_t)(destination >> 8), (uint8_t)destination};
+        return GDOOR_PROTOCOL::pack(data, (uint8_t)a, (uint8_t)type, source_bytes, parameter_bytes,
+                                    destination != 0 ? destination_bytes : NULL);
+    }
+
+    /*
+    * Parser for json bus messages, as printed on serial (json mode)
+    * and published on the MQTT bus_rx topic. Only "busdata" is read,
+    * the other fields are derived from it. BUS_IDLE and
+    * diagnostics have no busdata and are not parsed.
+    */
+    class json_parser {
+        public:
+            /*
+            * @param json one json message
+            * @param f returns the frame, data points into this parser
+            * @return false if json has no bus data
+            */
+            bool parse(const char *json, size_t len, frame &f) {
+                static const char key[] = "\"busdata\"";
+                const char *end = json + len;
+                const char *p = (const char*)memmem(json, len, key, sizeof(key) - 1);
+                if (p == NULL) {
+                    return false;
+                }
+                p = (const char*)memchr(p + sizeof(key) - 1, '"', end - p - (sizeof(key) - 1));
+                if (p == NULL) {
+                    return false;
+                }
+                p++;
+                uint8_t n = 0;
+                while (p + 1 < end && *p != '"' && n < MAX_WORDLEN) {
+                    int high = hexvalue(p[0]);
+                    int low = hexvalue(p[1]);
+                    if (high < 0 || low < 0) {
+                        return false;
+                    }
+                    data[n++] = (high << 4) | low;
+                    p += 2;
+                }
+                if (n == 0 || p >= end || *p != '"') {
+                    return false;
+                }
+                uint8_t crc = 0;
+                for (uint8_t i=0; i<n-1; i++) {
+                    crc += data[i];
+                }
+                f.data = data;
+                f.len = n;
+                f.valid = crc == data[n-1];
+                f.sequence = 0;
+                f.timestamp_us = 0;
+                return true;
+            }
+
+        private:
+            uint8_t data[MAX_WORDLEN];
+    };
+
+    /*
+    * Decoder for a json lines stream (serial port in json mode),
+    * feed it with data as read from the port.
+    */
+    class line_decoder {
+        public:
+            std::function<void(const frame&)> on_frame;
+            std::function<void(const char *json, size_t len)> on_json; // Lines without bus data
+
+            void feed(const uint8_t *buffer, size_t len) {
+                const char *p = (const char*)buffer;
+                const char *end = p + len;
+                while (p < end) {
+                    const char *newline = (const char*)memchr(p, '\n', end - p);
+                    if (newline == NULL) {
+                        line.append(p, end - p);
+                        return;
+                    }
+                    if (line.empty()) { // Complete line in buffer, no copy
+                        dispatch(p, newline - p);
+                    } else {
+                        line.append(p, newline - p);
+                        dispatch(line.data(), line.size());
+                        line.clear();
+                    }
+                    p = newline + 1;
+                }
+            }
+
+        private:
+            void dispatch(const char *json, size_t len) {
+                while (len > 0 && (json[len-1] == '\r' || json[len-1] == ' ')) {
+                    len--;
+                }
+                if (len == 0) {
+                    return;
+                }
+                frame f;
+                if (parser.parse(json, len, f)) {
+                    if (on_frame) {
+                        on_frame(f);
+                    }
+                } else if (on_json) {
+                    on_json(json, len);
+                }
+            }
+
+            json_parser parser;
+            std::string line;
+    };
+
+    /*
+    * CRC-16/CCITT-FALSE, as GDOOR_UTILS::crc16 of the firmware.
+    */
+    inline uint16_t crc16(const uint8_t *data, size_t len, uint16_t crc = 0xFFFF) {
+        for (size_t i=0; i<len; i++) {
+            crc ^= (uint16_t)data[i] << 8;
+            for (uint8_t bit=0; bit<8; bit++) {
+                crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+            }
+        }
+        return crc;
+    }
+
+    /*
+    * Creates one message of the framed serial protocol, COBS encoded with delimiter.
+    * @param type SERIAL_MSG_TX or SERIAL_MSG_COMMAND
+    * @param sequence returned in the acknowledgement
+    */
+    inline std::string serial_message(uint8_t type, uint8_t sequence, const uint8_t *payload, size_t len) {
+        std::string message;
+        message.reserve(len + SERIAL_FRAMING_LEN);
+        message.push_back(type);
+        message.push_back(sequence);
+        message.append((const char*)payload, len);
+        uint16_t crc = crc16((const uint8_t*)message.data(), message.size());
+        message.push_back(crc & 0xFF);
+        message.push_back(crc >> 8);
+
+        std::string encoded;
+        encoded.reserve(message.size() + message.size()/254 + 2);
+        size_t code_index = 0;
+        encoded.push_back(0); // Code byte, set when block is complete
+        for (size_t i=0; i<message.size(); i++) {
+            if (message[i] == 0) {
+                encoded[code_index] = encoded.size() - code_index;
+                code_index = encoded.size();
+                encoded.push_back(0);
+            } else {
+                encoded.push_back(message[i]);
+                if (encoded.size() - code_index == 0xFF) {
+                    encoded[code_index] = (char)0xFF;
+                    code_index = encoded.size();
+                    encoded.push_back(0);
+                }
+            }
+        }
+        encoded[code_index] = encoded.size() - code_index;
+        encoded.push_back(0); // Delimiter
+        return encoded;
+    }
+
+    /*
+    * Decoder for the framed serial protocol,
+    * feed it with data as read from the port.
+    * Callbacks are called from feed().
+    */
+    class serial_decoder {
+        public:
+            std::function<void(const frame&)> on_frame;
+            std::function<void(uint8_t type, uint8_t sequence, uint8_t status)> on_ack;
+            std::function<void(uint8_t type, const char *text, size_t len)> on_text; // SERIAL_MSG_JSON, SERIAL_MSG_MESSAGE, SERIAL_MSG_DEBUG
+            std::function<void(const uint8_t *data, size_t len)> on_capture; // Capture stream, see software/gdoor-capture
+            uint64_t errors = 0; // Messages with framing or CRC error
+            uint64_t lost = 0; // Messages lost, by gaps in the message sequence
+
+            serial_decoder() {
+                message.reserve(MESSAGE_MAX + MESSAGE_MAX/254 + 2);
+            }
+
+            void feed(const uint8_t *buffer, size_t len) {
+                const uint8_t *p = buffer;
+                const uint8_t *end = buffer + len;
+                while (p < end) {
+                    const uint8_t *delimiter = (const uint8_t*)memchr(p, 0, end - p);
+                    const uint8_t *stop = delimiter ? delimiter : end;
+                    if (message.size() + (stop - p) > message.capacity()) {
+                        overflow = true;
+                    } else {
+                        message.append((const char*)p, stop - p);
+                    }
+                    if (delimiter == NULL) {
+                        return;
+                    }
+                    if (!message.empty() || overflow) {
+                        dispatch();
+                    }
+                    message.clear();
+                    overflow = false;
+                    p = delimiter + 1;
+                }
+            }
+
+        private:
+            /*
+            * In place COBS decoder.
+            * @return decoded length, -1 on framing error
+            */
+            static long decode(uint8_t *data, size_t len) {
+                size_t in = 0;
+                size_t out = 0;
+                while (in < len) {
+                    uint8_t code = data[in++];
+                    if (in + code - 1 > len) {
+                        return -1;
+                    }
+                    memmove(&data[out], &data[in], code - 1);
+                    out += code - 1;
+                    in += code - 1;
+                    if (code < 0xFF && in < len) {
+                        data[out++] = 0;
+                    }
+                }
+                return out;
+            }
+
+            void dispatch() {
+                uint8_t *data = (uint8_t*)&message[0];
+                long len = overflow ? -1 : decode(data, message.size());
+                if (len < SERIAL_FRAMING_LEN || crc16(data, len - 2) != (data[len-2] | (data[len-1] << 8))) {
+                    errors++;
+                    return;
+                }
+                uint8_t type = data[SERIAL_OFFSET_TYPE];
+                if (synced) {
+                    lost += (uint8_t)(data[SERIAL_OFFSET_SEQUENCE] - sequence - 1);
+                }
+                synced = true;
+                sequence = data[SERIAL_OFFSET_SEQUENCE];
+
+                const uint8_t *payload = &data[SERIAL_OFFSET_PAYLOAD];
+                size_t payload_len = len - SERIAL_FRAMING_LEN;
+                frame f;
+                switch (type) {
+                    case SERIAL_MSG_FRAME:
+                        if (on_frame && parse_binary(payload, payload_len, f)) {
+                            on_frame(f);
+                        }
+                        break;
+                    case SERIAL_MSG_ACK:
+                        if (on_ack && payload_len >= 3) {
+                            on_ack(payload[0], payload[1], payload[2]);
+                        }
+                        break;
+                    case SERIAL_MSG_JSON:
+                    case SERIAL_MSG_MESSAGE:
+                    case SERIAL_MSG_DEBUG:
+                        if (on_text) {
+                            on_text(type, (const char*)payload, payload_len);
+                        }
+                        break;
+                    case SERIAL_MSG_CAPTURE:
+                        if (on_capture) {
+                            on_capture(payload, payload_len);
+                        }
+                        break;
+                }
+            }
+
+            std::string message;
+            bool overflow = false;
+            bool synced = false;
+            uint8_t sequence = 0;
+    };
+}
+
+#endif
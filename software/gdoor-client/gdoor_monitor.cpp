@@ -0,0 +1,95 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+* Example client: prints bus frames of an adapter,
+* lines on stdin are sent to the adapter.
+*/
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include "gdoor_transport.h"
+
+using namespace GDOOR_CLIENT;
+
+void print_frame(const frame &f) {
+    std::string busdata = hexstring(f.data, f.len);
+    if (f.has_protocol()) {
+        printf("%10u %12u %-28s %-16s %06X -> %06X %04X %s\n", f.sequence, f.timestamp_us,
+            f.action_name(), f.type_name(), f.source(), f.destination(), f.parameters(), busdata.c_str());
+    } else {
+        printf("%10u %12u %-28s %s\n", f.sequence, f.timestamp_us, f.valid ? "SHORT" : "INVALID", busdata.c_str());
+    }
+    fflush(stdout);
+}
+
+int usage(const char *name) {
+    fprintf(stderr, "Usage: %s serial <device> [baud] [binary]\n"
+        "       %s udp [multicast group] [port]\n"
+        "Lines on stdin are sent: commands or hex bus data (serial), hex bus data (udp)\n", name, name);
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        return usage(argv[0]);
+    }
+    std::string mode = argv[1];
+    try {
+        if (mode == "serial" && argc >= 3) {
+            uint32_t baud = argc >= 4 ? std::stoul(argv[3]) : 115200;
+            bool binary = argc >= 5 && std::string(argv[4]) == "binary";
+            serial_client client(argv[2], baud, binary);
+            client.decoder.on_frame = print_frame;
+            client.lines.on_frame = print_frame;
+            client.decoder.on_text = [](uint8_t type, const char *text, size_t len) {
+                printf("%s %.*s\n", type == SERIAL_MSG_DEBUG ? "debug" : "message", (int)len, text);
+            };
+            client.decoder.on_ack = [](uint8_t type, uint8_t sequence, uint8_t status) {
+                printf("ack %u: %s\n", sequence, status == SERIAL_ACK_OK ? "ok" : "rejected");
+            };
+            client.lines.on_json = [](const char *json, size_t len) {
+                printf("%.*s\n", (int)len, json);
+            };
+            client.start();
+            for (std::string line; std::getline(std::cin, line);) {
+                client.send_command(line);
+            }
+        } else if (mode == "udp") {
+            std::string group = argc >= 3 ? argv[2] : "";
+            uint16_t port = argc >= 4 ? std::stoul(argv[3]) : UDP_DEFAULT_PORT;
+            udp_client client(group, port);
+            client.on_frame = print_frame;
+            client.start();
+            for (std::string line; std::getline(std::cin, line);) {
+                uint8_t data[MAX_WORDLEN];
+                size_t len = 0;
+                for (size_t i=0; i+1<line.size() && len<MAX_WORDLEN-1; i+=2) {
+                    data[len++] = (hexvalue(line[i]) << 4) | hexvalue(line[i+1]);
+                }
+                if (!client.send_tx(data, len)) {
+                    fprintf(stderr, "Adapter not known yet\n");
+                }
+            }
+        } else {
+            return usage(argv[0]);
+        }
+    } catch (const std::exception &e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
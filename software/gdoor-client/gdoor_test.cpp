@@ -0,0 +1,224 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+* Round trip tests of encoder and parsers: every action/type combination
+* is encoded, sent through the binary and the json format and decoded again.
+* Canned records of the adapter check the shared formats (gdoor_formats.h).
+* Run with make test, exits with 1 if a check failed.
+*/
+#include <cstdio>
+#include <vector>
+#include "gdoor_client.h"
+
+using namespace GDOOR_CLIENT;
+
+static int failures = 0;
+
+#define CHECK(condition, ...) { \
+            if (!(condition)) { \
+                printf("FAIL %s:%d %s: ", __FILE__, __LINE__, #condition); \
+                printf(__VA_ARGS__); \
+                printf("\n"); \
+                failures++; \
+            } \
+        }
+
+/*
+* Bus data with checksum, as received by the adapter.
+*/
+std::vector<uint8_t> with_checksum(const uint8_t *data, size_t len) {
+    std::vector<uint8_t> frame(data, data + len);
+    uint8_t crc = 0;
+    for (size_t i=0; i<len; i++) {
+        crc += data[i];
+    }
+    frame.push_back(crc);
+    return frame;
+}
+
+/*
+* Binary record of a received frame, as sent on the UDP stream.
+*/
+std::vector<uint8_t> binary_record(const std::vector<uint8_t> &frame, bool valid) {
+    uint8_t header[BINARY_HEADER_LEN] = {'G', 'D', BINARY_VERSION, BINARY_TYPE_FRAME};
+    put32(&header[4], 42);
+    put32(&header[8], 123456);
+    header[12] = valid ? BINARY_FLAG_VALID : 0;
+    header[13] = frame.size();
+    std::vector<uint8_t> record(header, header + BINARY_HEADER_LEN);
+    for (uint8_t value : frame) {
+        record.push_back(value);
+    }
+    return record;
+}
+
+/*
+* Json record of a received frame, as printed on serial and published via MQTT.
+*/
+std::string json_record(const std::vector<uint8_t> &frame) {
+    return "{\"action\": \"X\", \"busdata\": \"" + hexstring(frame.data(), frame.size()) + "\", \"event_id\": \"1\"}";
+}
+
+void check_fields(const char *format, const frame &f, action a, hwtype type, uint32_t source,
+                  uint16_t parameters, uint32_t destination) {
+    CHECK(f.valid && f.has_protocol(), "%s %s/%s", format, action_name((uint8_t)a), hwtype_name((uint8_t)type));
+    if (!f.has_protocol()) {
+        return;
+    }
+    CHECK(f.action() == a, "%s %s decoded as %s", format, action_name((uint8_t)a), f.action_name());
+    CHECK(f.type() == type, "%s %s decoded as %s", format, hwtype_name((uint8_t)type), f.type_name());
+    CHECK(f.source() == source, "%s source %06X decoded as %06X", format, source, f.source());
+    CHECK(f.parameters() == parameters, "%s parameters %04X decoded as %04X", format, parameters, f.parameters());
+    CHECK(f.destination() == destination, "%s destination %06X decoded as %06X", format, destination, f.destination());
+}
+
+/*
+* Encodes every known action/type combination, with and without destination,
+* with GDOOR_PROTOCOL::pack, the byte packing of the firmware encoder,
+* and decodes it from a binary and a json record.
+*/
+void test_roundtrip() {
+    #define GDOOR_TEST_VALUE(value, name) value,
+    const uint8_t actions[] = {GDOOR_PROTOCOL_ACTIONS(GDOOR_TEST_VALUE)};
+    const uint8_t types[] = {GDOOR_PROTOCOL_HWTYPES(GDOOR_TEST_VALUE)};
+    #undef GDOOR_TEST_VALUE
+    const uint32_t source = 0xA286B1;
+    const uint16_t parameters = 0x1234;
+    const uint8_t source_bytes[3] = {0xA2, 0x86, 0xB1};
+    const uint8_t parameter_bytes[2] = {0x12, 0x34};
+    const uint8_t destination_bytes[3] = {0x5C, 0x8D, 0x47};
+    uint32_t combinations = 0;
+
+    for (uint8_t a : actions) {
+        for (uint8_t t : types) {
+            for (uint32_t destination : {(uint32_t)0, (uint32_t)0x5C8D47}) {
+                uint8_t data[12];
+                size_t len = GDOOR_PROTOCOL::pack(data, a, t, source_bytes, parameter_bytes,
+                                                  destination ? destination_bytes : NULL);
+                CHECK(len == (destination ? 12u : 9u), "length %zu", len);
+                uint8_t client[12];
+                CHECK(encode(client, (action)a, (hwtype)t, source, parameters, destination) == len
+                      && memcmp(client, data, len) == 0, "encode differs from pack %s", action_name(a));
+                std::vector<uint8_t> bus = with_checksum(data, len);
+
+                frame f;
+                std::vector<uint8_t> record = binary_record(bus, true);
+                CHECK(parse_binary(record.data(), record.size(), f), "binary %s", action_name(a));
+                check_fields("binary", f, (action)a, (hwtype)t, source, parameters, destination);
+
+                json_parser parser;
+                std::string json = json_record(bus);
+                CHECK(parser.parse(json.data(), json.size(), f), "json %s", action_name(a));
+                check_fields("json", f, (action)a, (hwtype)t, source, parameters, destination);
+                combinations++;
+            }
+        }
+    }
+    printf("round trip: %u combinations\n", combinations);
+}
+
+/*
+* Frames which must not decode as valid protocol data.
+*/
+void test_invalid() {
+    uint8_t data[12];
+    size_t len = encode(data, action::DOOR_OPEN, hwtype::INDOOR, 0xA286B1, 0, 0x5C8D47);
+    std::vector<uint8_t> bus = with_checksum(data, len);
+    frame f;
+    json_parser parser;
+
+    // Bad checksum
+    std::vector<uint8_t> bad = bus;
+    bad.back() ^= 0x01;
+    std::string json = json_record(bad);
+    CHECK(parser.parse(json.data(), json.size(), f) && !f.valid && !f.has_protocol(), "json bad checksum");
+    std::vector<uint8_t> record = binary_record(bad, false);
+    CHECK(parse_binary(record.data(), record.size(), f) && !f.valid && !f.has_protocol(), "binary bad checksum");
+
+    // Short frame, valid checksum but too short for the protocol fields
+    std::vector<uint8_t> short_frame = with_checksum(data, 5);
+    json = json_record(short_frame);
+    CHECK(parser.parse(json.data(), json.size(), f) && f.valid && !f.has_protocol(), "json short frame");
+    record = binary_record(short_frame, true);
+    CHECK(parse_binary(record.data(), record.size(), f) && !f.has_protocol(), "binary short frame");
+
+    // Truncated records
+    record = binary_record(bus, true);
+    CHECK(!parse_binary(record.data(), record.size() - 1, f), "binary record shorter than its length field");
+    CHECK(!parse_binary(record.data(), BINARY_HEADER_LEN - 1, f), "binary header only");
+    json = "{\"busdata\": \"0110A2";
+    CHECK(!parser.parse(json.data(), json.size(), f), "json without closing quote");
+    json = "{\"busdata\": \"01X0\"}";
+    CHECK(!parser.parse(json.data(), json.size(), f), "json with invalid hex");
+
+    // TX records are no received frames
+    record = binary_record(bus, true);
+    record[3] = BINARY_TYPE_TX;
+    CHECK(!parse_binary(record.data(), record.size(), f), "binary TX record");
+}
+
+/*
+* Records as sent by the adapter: DOOR_OPEN of INDOOR A286B1 to 5C8D47.
+* Offsets and constants come from gdoor_formats.h, the canned bytes check them.
+*/
+void test_canned() {
+    const uint8_t udp[] = { // UDP datagram, sequence 7, timestamp 1234567us
+        0x47, 0x44, 0x01, 0x01, 0x07, 0x00, 0x00, 0x00, 0x87, 0xD6, 0x12, 0x00, 0x01, 0x0D,
+        0x02, 0x00, 0x31, 0xA2, 0x86, 0xB1, 0x00, 0x00, 0xA1, 0x5C, 0x8D, 0x47, 0xDD};
+    const uint8_t serial[] = { // SERIAL_MSG_FRAME with the datagram as payload, message sequence 5
+        0x08, 0x01, 0x05, 0x47, 0x44, 0x01, 0x01, 0x07, 0x01, 0x01, 0x04, 0x87, 0xD6, 0x12, 0x04, 0x01,
+        0x0D, 0x02, 0x05, 0x31, 0xA2, 0x86, 0xB1, 0x01, 0x08, 0xA1, 0x5C, 0x8D, 0x47, 0xDD, 0xD3, 0xCB, 0x00};
+    const char json[] = "{\"action\": \"DOOR_OPEN\", \"parameters\": \"0000\", \"source\": \"A286B1\", "
+        "\"destination\": \"5C8D47\", \"type\": \"INDOOR\", \"busdata\": \"020031A286B10000A15C8D47DD\", "
+        "\"quality\": {\"startbit\": \"77\", \"margin\": \"9\"}, \"event_id\": \"3\"}\r\n";
+
+    frame f;
+    CHECK(parse_binary(udp, sizeof(udp), f), "canned UDP datagram");
+    check_fields("canned binary", f, action::DOOR_OPEN, hwtype::INDOOR, 0xA286B1, 0x0000, 0x5C8D47);
+    CHECK(f.sequence == 7 && f.timestamp_us == 1234567, "sequence %u, timestamp %u", f.sequence, f.timestamp_us);
+
+    uint32_t frames = 0;
+    serial_decoder decoder;
+    decoder.on_frame = [&frames](const frame &f) {
+        check_fields("canned serial", f, action::DOOR_OPEN, hwtype::INDOOR, 0xA286B1, 0x0000, 0x5C8D47);
+        frames++;
+    };
+    for (uint8_t b : serial) { // Byte by byte, as from a slow port
+        decoder.feed(&b, 1);
+    }
+    CHECK(frames == 1 && decoder.errors == 0, "canned serial: %u frames, %llu errors", frames,
+          (unsigned long long)decoder.errors);
+    std::string encoded = serial_message(SERIAL_MSG_FRAME, 5, udp, sizeof(udp));
+    CHECK(encoded == std::string((const char*)serial, sizeof(serial)), "serial_message differs from canned message");
+
+    frames = 0;
+    line_decoder lines;
+    lines.on_frame = [&frames](const frame &f) {
+        check_fields("canned json", f, action::DOOR_OPEN, hwtype::INDOOR, 0xA286B1, 0x0000, 0x5C8D47);
+        frames++;
+    };
+    lines.feed((const uint8_t*)json, sizeof(json) - 1);
+    CHECK(frames == 1, "canned json: %u frames", frames);
+}
+
+int main() {
+    test_roundtrip();
+    test_invalid();
+    test_canned();
+    printf("%s, %d failures\n", failures ? "FAILED" : "OK", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,318 @@
+/* 
+ * This file is part of the GDoor distribution (https://github.com/gdoor-org).
+ * Copyright (c) 2024 GDoor authors.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GDOOR_TRANSPORT_H
+#define GDOOR_TRANSPORT_H
+/*
+* Linux transports for GDoor adapters: serial port (json lines or framed
+* protocol) and UDP stream. Each runs a reader thread, callbacks are
+* called from this thread. Header only, C++17, link with -pthread.
+*/
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <unistd.h>
+#include "gdoor_client.h"
+
+namespace GDOOR_CLIENT {
+    const uint16_t UDP_DEFAULT_PORT = 5071;
+
+    /*
+    * Internal, reader thread which calls read_available() when fd is readable.
+    */
+    class reader_thread {
+        public:
+            virtual ~reader_thread() { // Derived classes call stop() first
+                if (fd >= 0) {
+                    close(fd);
+                }
+            }
+
+            void start() {
+                running = true;
+                thread = std::thread([this]() {
+                    struct pollfd pfd = {fd, POLLIN, 0};
+                    while (running) {
+                        if (poll(&pfd, 1, 100) > 0 && !read_available()) {
+                            break;
+                        }
+                    }
+                });
+            }
+
+            void stop() {
+                running = false;
+                if (thread.joinable()) {
+                    thread.join();
+                }
+            }
+
+        protected:
+            /* @return false on read error, stops the thread */
+            virtual bool read_available() = 0;
+
+            int fd = -1;
+            std::mutex write_mutex;
+
+        private:
+            std::atomic<bool> running{false};
+            std::thread thread;
+    };
+
+    /*
+    * Serial port of an adapter.
+    * Set the callbacks of decoder (binary) or lines (json) before start().
+    */
+    class serial_client : public reader_thread {
+        public:
+            serial_decoder decoder; // Framed serial protocol
+            line_decoder lines; // Json lines
+
+            /*
+            * @param device e.g. /dev/ttyUSB0
+            * @param baud baud rate as configured on the adapter
+            * @param binary true: framed serial protocol, false: json lines
+            */
+            serial_client(const std::string &device, uint32_t baud, bool binary) : binary(binary) {
+                fd = open(device.c_str(), O_RDWR | O_NOCTTY);
+                if (fd < 0) {
+                    throw std::runtime_error("cannot open " + device);
+                }
+                struct termios tty;
+                if (tcgetattr(fd, &tty) != 0) {
+                    throw std::runtime_error(device + " is no serial port");
+                }
+                cfmakeraw(&tty);
+                speed_t speed = baud_constant(baud);
+                cfsetispeed(&tty, speed);
+                cfsetospeed(&tty, speed);
+                tty.c_cc[VMIN] = 0;
+                tty.c_cc[VTIME] = 0;
+                if (tcsetattr(fd, TCSANOW, &tty) != 0) {
+                    throw std::runtime_error("cannot configure " + device);
+                }
+                if (binary) {
+                    write_all(std::string(1, '\0')); // Discard partial input on the adapter
+                }
+            }
+
+            ~serial_client() {
+                stop();
+            }
+
+            /*
+            * Sends bus data.
+            * @param data bus data without checksum
+            * @return sequence number of the message, see serial_decoder::on_ack (binary only)
+            */
+            uint8_t send_tx(const uint8_t *data, size_t len) {
+                if (!binary) {
+                    write_all(hexstring(data, len) + "\n");
+                    return 0;
+                }
+                return send_message(SERIAL_MSG_TX, (const uint8_t*)data, len);
+            }
+
+            /*
+            * Sends a text command, e.g. *metrics, a hex string or a json command.
+            * @return sequence number of the message (binary only)
+            */
+            uint8_t send_command(const std::string &command) {
+                if (!binary) {
+                    write_all(command + "\n");
+                    return 0;
+                }
+                return send_message(SERIAL_MSG_COMMAND, (const uint8_t*)command.data(), command.size());
+            }
+
+        protected:
+            virtual bool read_available() {
+                uint8_t buffer[4096];
+                ssize_t n = read(fd, buffer, sizeof(buffer));
+                if (n <= 0) { // Readable without data: port is gone
+                    return false;
+                }
+                if (binary) {
+                    decoder.feed(buffer, n);
+                } else {
+                    lines.feed(buffer, n);
+                }
+                return true;
+            }
+
+        private:
+            static speed_t baud_constant(uint32_t baud) {
+                switch (baud) {
+                    case 9600: return B9600;
+                    case 19200: return B19200;
+                    case 38400: return B38400;
+                    case 57600: return B57600;
+                    case 115200: return B115200;
+                    case 230400: return B230400;
+                    case 460800: return B460800;
+                    case 500000: return B500000;
+                    case 921600: return B921600;
+                    case 1000000: return B1000000;
+                    case 1500000: return B1500000;
+                    case 2000000: return B2000000;
+                }
+                throw std::runtime_error("unsupported baud rate " + std::to_string(baud));
+            }
+
+            uint8_t send_message(uint8_t type, const uint8_t *payload, size_t len) {
+                std::lock_guard<std::mutex> lock(write_mutex);
+                uint8_t sequence = next_sequence++;
+                write_locked(serial_message(type, sequence, payload, len));
+                return sequence;
+            }
+
+            void write_all(const std::string &s) {
+                std::lock_guard<std::mutex> lock(write_mutex);
+                write_locked(s);
+            }
+
+            void write_locked(const std::string &s) {
+                size_t written = 0;
+                while (written < s.size()) {
+                    ssize_t n = write(fd, s.data() + written, s.size() - written);
+                    if (n < 0) {
+                        throw std::runtime_error("serial write failed");
+                    }
+                    written += n;
+                }
+            }
+
+            bool binary;
+            uint8_t next_sequence = 0;
+    };
+
+    /*
+    * UDP stream of an adapter (config portal "UDP stream").
+    * Set on_frame before start().
+    */
+    class udp_client : public reader_thread {
+        public:
+            std::function<void(const frame&)> on_frame;
+            std::atomic<uint64_t> lost{0}; // Frames lost, by gaps in the sequence number
+            std::atomic<uint64_t> restarts{0}; // Sequence number started again, e.g. adapter reboot
+
+            /*
+            * @param group multicast group, or empty for a unicast stream to this host
+            * @param port UDP port
+            */
+            udp_client(const std::string &group, uint16_t port = UDP_DEFAULT_PORT) {
+                fd = socket(AF_INET, SOCK_DGRAM, 0);
+                if (fd < 0) {
+                    throw std::runtime_error("cannot create socket");
+                }
+                int reuse = 1;
+                setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+                struct sockaddr_in addr = {};
+                addr.sin_family = AF_INET;
+                addr.sin_port = htons(port);
+                addr.sin_addr.s_addr = htonl(INADDR_ANY);
+                if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+                    throw std::runtime_error("cannot bind port " + std::to_string(port));
+                }
+                if (!group.empty()) {
+                    struct ip_mreq mreq = {};
+                    if (inet_pton(AF_INET, group.c_str(), &mreq.imr_multiaddr) != 1) {
+                        throw std::runtime_error("invalid group " + group);
+                    }
+                    mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+                    if (setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) != 0) {
+                        throw std::runtime_error("cannot join " + group);
+                    }
+                    adapter = addr;
+                    adapter.sin_addr = mreq.imr_multiaddr;
+                    adapter_known = true;
+                    multicast = true;
+                }
+            }
+
+            ~udp_client() {
+                stop();
+            }
+
+            /*
+            * Sends bus data to the group, or to the adapter which
+            * sent the last frame (unicast). The adapter only accepts it
+            * from the IP configured as "UDP TX" in the config portal.
+            * @param data bus data without checksum
+            * @return false if the adapter is not known yet (unicast)
+            */
+            bool send_tx(const uint8_t *data, size_t len) {
+                std::lock_guard<std::mutex> lock(write_mutex);
+                if (!adapter_known) {
+                    return false;
+                }
+                std::string datagram = binary_tx(data, len);
+                return sendto(fd, datagram.data(), datagram.size(), 0, (struct sockaddr*)&adapter, sizeof(adapter)) > 0;
+            }
+
+        protected:
+            virtual bool read_available() {
+                uint8_t datagram[BINARY_HEADER_LEN + MAX_WORDLEN];
+                struct sockaddr_in sender;
+                socklen_t sender_len = sizeof(sender);
+                ssize_t n = recvfrom(fd, datagram, sizeof(datagram), 0, (struct sockaddr*)&sender, &sender_len);
+                if (n < 0) {
+                    return false;
+                }
+                frame f;
+                if (!parse_binary(datagram, n, f)) { // e.g. own TX datagrams on the group
+                    return true;
+                }
+                if (synced) {
+                    // A jump back, or a new start at 0/1 which is no wrap around, is a restart of
+                    // the adapter, frames between last frame and restart are unknown
+                    uint32_t gap = f.sequence - sequence - 1;
+                    if (gap >= 0x80000000u || (f.sequence <= 1 && gap != 0)) {
+                        restarts++;
+                    } else {
+                        lost += gap;
+                    }
+                }
+                synced = true;
+                sequence = f.sequence;
+                if (!multicast) { // Reply to the adapter
+                    std::lock_guard<std::mutex> lock(write_mutex);
+                    adapter = sender;
+                    adapter_known = true;
+                }
+                if (on_frame) {
+                    on_frame(f);
+                }
+                return true;
+            }
+
+        private:
+            struct sockaddr_in adapter = {};
+            bool adapter_known = false;
+            bool multicast = false;
+            bool synced = false;
+            uint32_t sequence = 0;
+    };
+}
+
+#endif